@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+
+#include "arena.h"
+
+u64 Arena::getCapacity() const {
+    u64 capacity = 0;
+    for (const Block& block : blocks) {
+        capacity += block.size;
+    }
+    return capacity;
+}
+
+void* Arena::do_allocate(const std::size_t bytes, const std::size_t alignment) {
+    // blocks that are kept from before a reset are reused in order, too small ones are skipped
+    for (; current < blocks.size(); ++current, offset = 0) {
+        Block& block = blocks[current];
+        const u64 base = reinterpret_cast<u64>(block.data.get());
+        const u64 start = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+        if (start + bytes <= block.size) {
+            offset = start + bytes;
+            return block.data.get() + start;
+        }
+    }
+
+    const u64 size = std::max<u64>(BlockSize, bytes + alignment);
+    blocks.push_back(Block{ std::make_unique_for_overwrite<std::byte[]>(size), size });
+    current = blocks.size() - 1;
+    const u64 base = reinterpret_cast<u64>(blocks.back().data.get());
+    const u64 start = ((base + alignment - 1) & ~(alignment - 1)) - base;
+    offset = start + bytes;
+    return blocks.back().data.get() + start;
+}
@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include "types.h"
+
+// Bump allocator for data that dies all at once. Deallocating is a no-op, reset() drops every
+// allocation in one step and keeps the blocks for whatever gets allocated next.
+class Arena : public std::pmr::memory_resource {
+    public:
+        static constexpr u64 BlockSize = 64 * 1024;
+
+        Arena() = default;
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        void reset() {
+            current = 0;
+            offset = 0;
+        }
+
+        // Only for trivially destructible types, their destructors would never run
+        template <typename T>
+        std::span<T> allocate(const u64 count) {
+            if (count == 0) {
+                return {};
+            }
+            T* data = static_cast<T*>(std::pmr::memory_resource::allocate(count * sizeof(T), alignof(T)));
+            std::uninitialized_value_construct_n(data, count);
+            return { data, count };
+        }
+
+        template <typename T>
+        std::span<const T> copy(const std::span<const T> items) {
+            std::span<T> data = allocate<T>(items.size());
+            std::ranges::copy(items, data.begin());
+            return data;
+        }
+
+        u64 getCapacity() const;
+
+    private:
+        struct Block {
+            std::unique_ptr<std::byte[]> data;
+            u64 size;
+        };
+
+        std::vector<Block> blocks;
+        u64 current = 0; // block that is being filled
+        u64 offset = 0;  // first free byte in it
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void*, std::size_t, std::size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+};
@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "global_state.h"
+
+// Creates and destroys many short-lived GlobalState instances the way batch runs do.
+// Usage: PagePoolBenchmark [iterations] [pages per run]
+int main(int argc, char *argv[]) {
+    const u64 iterations = argc > 1 ? std::stoull(argv[1]) : 10'000;
+    const u64 pagesPerRun = argc > 2 ? std::stoull(argv[2]) : 64;
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    for (u64 iteration = 0; iteration < iterations; ++iteration) {
+        auto globalState = std::make_unique<GlobalState>();
+        Interpreter::Memory& memory = globalState->memory;
+
+        // half of the pages are section data, the other half is stack
+        const u64 sectionPages = pagesPerRun / 2;
+        memory.mapSection(0, sectionPages * Interpreter::PageSize, Interpreter::Permission{ true, true, false });
+        for (u64 page = 0; page < sectionPages; ++page) {
+            memory.writeMemory<u64>(page * Interpreter::PageSize, page);
+        }
+        for (u64 page = 0; page < pagesPerRun - sectionPages; ++page) {
+            memory.writeMemory<u64>(UINT64_MAX - 7 - page * Interpreter::PageSize, page);
+        }
+    }
+    const auto endTime = std::chrono::high_resolution_clock::now();
+
+    const double duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
+    const Interpreter::PagePool::Statistics& statistics = Interpreter::PagePool::local().getStatistics();
+    std::cout << std::format("{} runs with {} pages each in {} ms ({} us per run)\n",
+                             iterations, pagesPerRun, duration, duration * 1000. / iterations);
+    std::cout << std::format("Pages: {} allocated ({} reused, {} released), {} slabs of {} pages\n",
+                             statistics.pageAllocations, statistics.pageReuses, statistics.pageReleases,
+                             statistics.slabAllocations, Interpreter::PagePool::PagesPerSlab);
+    return 0;
+}
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <optional>
 #include <variant>
 #include <source_location>
@@ -21,6 +22,11 @@ std::string save_minimal(Archive& archive, const Enum& e) {
     return std::string{ magic_enum::enum_name(e) };
 }
 
+template <class Archive>
+std::string save_minimal(Archive& archive, const std::string_view& view) {
+    return std::string{ view };
+}
+
 template <class Archive, typename T>
 void save(Archive& archive, const std::optional<T>& optional) {
     if (optional) {
@@ -3,9 +3,11 @@
 
 #pragma once
 
+#include <optional>
 #include <vector>
 
 #include "interpreter/symbol_table.h"
+#include "interpreter/io_backend.h"
 #include "interpreter/memory.h"
 #include "interpreter/registers.h"
 #include "testcases/testcase.h"
@@ -14,6 +16,7 @@ struct GlobalState {
     Interpreter::CPU cpu{};
     Interpreter::Memory memory{};
     SymbolTable symbolTable{};
-    std::vector<SymbolImmediate> symbolImmediates{};
     Testcases::Test testcase{};
+    // guest I/O the VM is suspended on
+    std::optional<Interpreter::IoRequest> pendingIo{};
 };
@@ -0,0 +1,58 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <array>
+#include <initializer_list>
+
+#include "types.h"
+
+// Fixed capacity list that can live in a constexpr table or inside an AST node without a heap allocation
+template <typename T, u32 Capacity>
+class InlineList {
+    public:
+        constexpr InlineList() = default;
+        constexpr InlineList(std::initializer_list<T> items) {
+            for (const T& item : items) {
+                data[count++] = item;
+            }
+        }
+
+        // the caller guarantees that the list is not full
+        constexpr void push_back(const T& item) {
+            data[count++] = item;
+        }
+
+        constexpr T* begin() {
+            return data.data();
+        }
+        constexpr T* end() {
+            return data.data() + count;
+        }
+        constexpr const T* begin() const {
+            return data.data();
+        }
+        constexpr const T* end() const {
+            return data.data() + count;
+        }
+        constexpr u32 size() const {
+            return count;
+        }
+        constexpr bool empty() const {
+            return count == 0;
+        }
+        constexpr T& operator[](u32 index) {
+            return data[index];
+        }
+        constexpr const T& operator[](u32 index) const {
+            return data[index];
+        }
+        constexpr T& back() {
+            return data[count - 1];
+        }
+
+    private:
+        std::array<T, Capacity> data{};
+        u32 count = 0;
+};
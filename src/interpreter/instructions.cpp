@@ -1,10 +1,12 @@
 // SPDX-FileCopyrightText: Copyright 2025 AsmCube Project
 // SPDX-License-Identifier: GPL-3.0-or-later
 
-#include "instructions.h"
+#include "mnemonics.h"
 #include "instructions_helper.h"
 #include "parser/parser.h"
 #include "interpreter.h"
+#include "syscall_recorder.h"
+#include "syscall_trace.h"
 #include "syscalls.h"
 #include "testcases/testcase.h"
 
@@ -363,12 +365,29 @@ u32 leave(GlobalState& globalState, Ast::Instruction& instruction) {
 }
 
 u32 syscall(GlobalState& globalState, Ast::Instruction& instruction) {
-    if (Syscalls::syscallTable.find(globalState.cpu.rax) == Syscalls::syscallTable.end()) {
-        LOG_ERROR("Unknown syscall number {}", globalState.cpu.rax);
+    const u64 number = globalState.cpu.rax;
+    const u64 startTime = syscallTracer.isEnabled() ? SyscallTracer::now() : 0;
+    if (Syscalls::asyncIo && !syscallRecorder.isActive() && Syscalls::prepareIo(globalState.cpu, globalState.memory, globalState.pendingIo)) {
+        globalState.pendingIo->number = number;
+        globalState.pendingIo->startTime = startTime;
+        globalState.cpu.rip += 8;
+        return 0;
+    }
+    const Syscalls::SyscallHandler handler = number < Syscalls::SyscallCount ? Syscalls::syscallTable[number] : nullptr;
+    if (handler == nullptr) {
+        LOG_ERROR("Unknown syscall number {}", number);
+    }
+    if (syscallRecorder.isActive() && Syscalls::hostSyscalls[number]) {
+        syscallRecorder.run(number, handler, globalState.cpu, globalState.memory);
+    }
+    else {
+        handler(globalState.cpu, globalState.memory);
+    }
+    if (syscallTracer.isEnabled()) {
+        syscallTracer.record(number, globalState.cpu, globalState.cpu.rip, startTime);
     }
-    Syscalls::syscallTable[globalState.cpu.rax](globalState.cpu, globalState.memory);
     globalState.cpu.rip += 8;
-    if (globalState.cpu.rax == 60) {
+    if (number == Syscalls::SyscallExit || number == Syscalls::SyscallExitGroup) {
         return 1;
     }
     return 0;
@@ -380,28 +399,27 @@ u32 checkpoint(GlobalState& globalState, Ast::Instruction& instruction) {
         for (Testcases::Checkpoint& checkpoint : globalState.testcase.checkpoints) {
             if (checkpoint.id == checkpointID) {
                 for (auto& [regName, value] : checkpoint.registers) {
-                    auto it = Parser::registerTable.find(regName);
-                    if (it == Parser::registerTable.end()) {
+                    const Parser::RegisterInfo* reg = Parser::registerTable.find(regName);
+                    if (reg == nullptr) {
                         LOG_ERROR("Checkpoint {}: unknown register '{}'", checkpointID, regName);
                     }
-                    const Ast::Register& reg = it->second;
 
                     u64 actual = 0;
-                    switch (reg.width) {
+                    switch (reg->width) {
                         case Ast::Width::Quad:
-                            actual = *globalState.cpu.reg64[reg.index];
+                            actual = *globalState.cpu.reg64[reg->index];
                             break;
 
                         case Ast::Width::Long:
-                            actual = *globalState.cpu.reg32[reg.index];
+                            actual = *globalState.cpu.reg32[reg->index];
                             break;
 
                         case Ast::Width::Word:
-                            actual = *globalState.cpu.reg16[reg.index];
+                            actual = *globalState.cpu.reg16[reg->index];
                             break;
 
                         case Ast::Width::Byte:
-                            actual = *globalState.cpu.reg8[reg.index];
+                            actual = *globalState.cpu.reg8[reg->index];
                             break;
                     }
 
@@ -7,6 +7,8 @@
 #include "registers.h"
 #include "memory.h"
 #include "interpreter.h"
+#include "scheduler.h"
+#include "syscall_trace.h"
 #include "syscalls.h"
 #include "mnemonics.h"
 
@@ -22,13 +24,13 @@ u64 resolveMemory(const Ast::Memory& memory, GlobalState& globalState) {
     if (memory.disp.has_value()) {
         displacement = std::get<s64>(*memory.disp);
 
-        if (memory.base.has_value() && memory.base->name == "rip") {
+        if (memory.base.has_value() && memory.base->isRip()) {
             displacement -= globalState.cpu.rip + 8;
         }
     }
 
     if (memory.base.has_value()) {
-        if (memory.base.value().name == "rip") {
+        if (memory.base->isRip()) {
             base = globalState.cpu.rip + 8;
         }
         else {
@@ -141,7 +143,7 @@ u64 readOperand(const Ast::Operand& operand,  Ast::Width targetSize, GlobalState
                     case Ast::Width::Byte:
                         return *globalState.cpu.reg8 [reg.index];
                 }
-                LOG_ERROR("Invalid register width for '{}'", reg.name);
+                LOG_ERROR("Invalid register width for register {}", reg.index);
             }
 
         case Ast::OperandType::Immediate:
@@ -151,7 +153,7 @@ u64 readOperand(const Ast::Operand& operand,  Ast::Width targetSize, GlobalState
             {
                 const auto& relative = std::get<Ast::RelativeImmediate>(operand);
                 if (std::holds_alternative<Ast::Label>(relative.target)) {
-                    LOG_ERROR("Unresolved relative immediate '{}' reached the interpreter", std::get<Ast::Label>(relative.target).name);
+                    LOG_ERROR("Unresolved relative immediate reached the interpreter");
                 }
 
                 return globalState.cpu.rip + 8 + std::get<s64>(relative.target);
@@ -159,7 +161,7 @@ u64 readOperand(const Ast::Operand& operand,  Ast::Width targetSize, GlobalState
 
         case Ast::OperandType::Symbol:
             {
-                LOG_ERROR("Unresolved symbol '{}' reached the interpreter", std::get<Ast::Symbol>(operand).name);
+                LOG_ERROR("Unresolved symbol reached the interpreter");
             }
 
         case Ast::OperandType::Memory:
@@ -214,7 +216,7 @@ void writeOperand(const Ast::Operand& operand, const u64 value,  Ast::Width targ
                         *globalState.cpu.reg8[reg.index] = static_cast<u8>(value);
                         return;
                 }
-                LOG_ERROR("Invalid register width for '{}'", reg.name);
+                LOG_ERROR("Invalid register width for register {}", reg.index);
             }
 
         case Ast::OperandType::Memory:
@@ -246,296 +248,64 @@ void writeOperand(const Ast::Operand& operand, const u64 value,  Ast::Width targ
     }
 }
 
-std::vector<u8> decodeAscii(const std::string& text) {
-    std::vector<u8> result;
-    for (u32 i = 0; i < text.size(); ++i) {
-        if (text[i] == '\\') {
-            switch (text[i + 1]) {
-                case 'n':
-                    result.push_back('\n');
-                    ++i;
-                    break;
-
-                case '0':
-                    result.push_back('\0');
-                    ++i;
-                    break;
-
-                default:
-                    LOG_ERROR("Unknown escape sequence in string '{}'", text);
-            }
-        }
-        else {
-            result.push_back(static_cast<u8>(text[i]));
-        }
-    }
-    return result;
-}
-
-u64 resolveSymbolValue(const std::string& name, GlobalState& globalState) {
-    std::string baseName = name;
-    if (auto it = name.find("@"); it != std::string::npos) {
-        baseName = name.substr(0, it);
-    }
-
-    for (const auto& symbolImmediate : globalState.symbolImmediates) {
-        if (symbolImmediate.name == baseName) {
-            return symbolImmediate.value;
-        }
-    }
-
-    if (auto it = globalState.symbolTable.symbols.find(baseName); it != globalState.symbolTable.symbols.end()) {
-        return it->second.address;
-    }
-
-    LOG_ERROR("Unknown symbol '{}'", name);
-}
-
-int run(Ast::Ast& ast, GlobalState& globalState) {
-    std::vector<LinkedInstruction> instructionList{};
-    u64 instructionID = 0;
-
-    // Linking
-    LOG_DEBUG("Start linking...");
+VmTask execute(GlobalState& globalState, LinkedProgram program) {
+    LOG_DEBUG("Starting execution...");
+    std::vector<LinkedInstruction>& instructionList = program.instructions;
+    u64& instructionPointer = globalState.cpu.rip;
     auto startTime = std::chrono::high_resolution_clock::now();
 
-    Permission permission{};
-    for (Ast::Section& section : ast) {
-        if (section.name[0] == '.') {
-            section.name = section.name.substr(1);
-        }
-        if (section.name == "rodata" || section.name.rfind("rodata.") == 0) {
-            permission = Permission{ true, false, false };
-        }
-        else if (section.name == "data" || section.name.rfind("data.") == 0) {
-            permission = Permission{ true, true, false };
-        }
-        else if (section.name == "bss" || section.name.rfind("bss.") == 0) {
-            permission = Permission{ true, true, false };
-        }
-        else if (section.name == "text" || section.name.rfind("text.") == 0) {
-            permission = Permission{ true, false, true };
-        }
-        else {
-            LOG_INFO("Unknown section name '{}'", section.name);
+    u64 counter = 0;
+    while (true) {
+        u64 instructionID = globalState.memory.fetchInstruction(instructionPointer);
+        counter++;
+        LinkedInstruction& instruction = instructionList[instructionID];
+        if (instruction.implementation == nullptr) [[unlikely]] {
+            // first instruction of a lazily linked function that runs
+            program.lazyFunctions.lower(instructionList, instructionID, globalState.symbolTable);
         }
-        std::string actualSymbolName;
-        for (const auto& item : section.items) {
-            switch (item.index()) {
-                case 0:
-                    {
-                        // Label
-                        actualSymbolName = std::get<Ast::Label>(item).name;
-                        break;
-                    }
-
-                case 1:
-                    {
-                        // Directive
-                        const Ast::Directive& directive = std::get<Ast::Directive>(item);
-                        switch (directive.name) {
-                            case Ast::Directive::Name::ascii:
-                                {
-                                    auto buffer = decodeAscii(directive.arguments[0]);
-                                    Symbol& symbol = globalState.symbolTable.addSymbol(actualSymbolName,buffer.size());
-                                    for (u64 i = 0; i < buffer.size(); ++i) {
-                                        globalState.memory.writeMemoryNoExcept(symbol.address + i, buffer[i]);
-                                    }
-                                    globalState.memory.setPermission(symbol.address, buffer.size(), permission);
-                                }
-                                break;
-
-                            case Ast::Directive::Name::asciz:
-                                {
-                                    auto buffer = decodeAscii(directive.arguments[0]);
-                                    buffer.push_back('\0');
-                                    Symbol& symbol = globalState.symbolTable.addSymbol(actualSymbolName,buffer.size());
-                                    for (u64 i = 0; i < buffer.size(); ++i) {
-                                        globalState.memory.writeMemoryNoExcept(symbol.address + i, buffer[i]);
-                                    }
-                                    globalState.memory.setPermission(symbol.address, buffer.size(), permission);
-                                }
-                                break;
-
-                            case Ast::Directive::Name::skip:
-                            case Ast::Directive::Name::space:
-                                {
-                                    u32 size = std::stoull(directive.arguments[0]);
-                                    u64 data = 0u;
-                                    if (directive.arguments.size() > 1) {
-                                        data = Parser::textToNumber(directive.arguments[1]);
-                                    }
-                                    Symbol& symbol = globalState.symbolTable.addSymbol(actualSymbolName, size);
-                                    for (u64 i = 0; i < size; ++i) {
-                                        globalState.memory.writeMemoryNoExcept(symbol.address + i, data);
-                                    }
-                                    globalState.memory.setPermission(symbol.address, size, Permission{ true, true, false });
-                                }
-                                break;
-
-                            case Ast::Directive::Name::zero:
-                                {
-                                    u32 size = std::stoull(directive.arguments[0]);
-                                    Symbol& symbol = globalState.symbolTable.addSymbol(actualSymbolName, size);
-                                    for (u64 i = 0; i < size; ++i) {
-                                        globalState.memory.writeMemoryNoExcept(symbol.address + i, 0u);
-                                    }
-                                    globalState.memory.setPermission(symbol.address, size, Permission{ true, true, false });
-                                }
-                                break;
-
-                            case Ast::Directive::Name::byte:
-                                {
-                                    u32 size = directive.arguments.size();
-                                    Symbol symbol;
-                                    if (globalState.symbolTable.hasSymbol(actualSymbolName)) {
-                                        symbol = globalState.symbolTable.extendSymbol(actualSymbolName, size);
-                                    }
-                                    else {
-                                        symbol = globalState.symbolTable.addSymbol(actualSymbolName, size);
-                                    }
-                                    for (u32 i = 0; i < size; ++i) {
-                                        u8 value = static_cast<u8>(Parser::textToNumber(directive.arguments[i]));
-                                        globalState.memory.writeMemoryNoExcept(symbol.address + i, value);
-                                    }
-                                    globalState.memory.setPermission(symbol.address, size, permission);
-                                }
-                                break;
-
-                            case Ast::Directive::Name::quad:
-                                {
-                                    u32 size = directive.arguments.size() * 8;
-                                    Symbol symbol;
-                                    if (globalState.symbolTable.hasSymbol(actualSymbolName)) {
-                                        symbol = globalState.symbolTable.extendSymbol(actualSymbolName, size);
-                                    }
-                                    else {
-                                        symbol = globalState.symbolTable.addSymbol(actualSymbolName, size);
-                                    }
-                                    for (u32 i = 0; i < directive.arguments.size(); ++i) {
-                                        auto& text = directive.arguments[i];
-                                        u64 value;
-                                        if (Parser::isNumber(text) || Parser::isHexNumber(text)) {
-                                            value = Parser::textToNumber(directive.arguments[i]);
-                                        }
-                                        else {
-                                            value = globalState.symbolTable.findSymbol(text).address; // ToDO fix with meoemrey nnode
-                                        }
-                                        globalState.memory.writeMemoryNoExcept(symbol.address + i * 8, value);
-                                    }
-                                    globalState.memory.setPermission(symbol.address, size, permission);
-                                }
-                                break;
-
-                            default:
-                                break;
-                        }
-                        break;
-                    }
-
-                case 2:
-                    {
-                        if (section.name != "text") {
-                            LOG_ERROR("Instructions can only be in the .text section");
-                        }
-
-                        Ast::Instruction instruction = std::get<Ast::Instruction>(item);
-                        if (instruction.operands.size() == 1) {
-                            instruction.operandWidth = getOperandSize(instruction.operands[0], instruction.mnemonic.width);
-                        }
-                        else if (instruction.operands.size() == 2) {
-                            instruction.operandWidth = getOperandSize(instruction.operands[0], instruction.operands[1], instruction.mnemonic.width);
-                        }
-
-                        Symbol symbol;
-                        if (globalState.symbolTable.hasSymbol(actualSymbolName)) {
-                            symbol = globalState.symbolTable.extendSymbol(actualSymbolName, 8);
-                        }
-                        else {
-                            symbol = globalState.symbolTable.addSymbol(actualSymbolName, 8);
-                        }
-
-                        LinkedInstruction linkedInstruction{
-                            instruction,
-                            Mnemonics::instructionDefinitions[instruction.mnemonic.mnemonicName].implementation,
-                            symbol.address,
-                        };
-                        instructionList.push_back(linkedInstruction);
-                        globalState.memory.writeMemoryNoExcept(symbol.address, instructionID);
-                        globalState.memory.setPermission(symbol.address, 8, permission);
-                        ++instructionID;
-                        break;
-                    }
-                case 3:
-                    {
-                        // SymbolAssignment
-                        const Ast::SymbolAssignment& symbolAssignment = std::get<Ast::SymbolAssignment>(item);
-                        const std::vector<Token>& tokens = symbolAssignment.expression.tokens;
-                        if (tokens[0].type == Token::Type::Dot && tokens[1].type == Token::Type::Dash) {
-                            globalState.symbolImmediates.push_back(SymbolImmediate{ symbolAssignment.name, globalState.symbolTable.symbols[tokens[2].lexeme].size });
-                        }
-                        break;
-                    }
+        u32 shouldExit = instruction.implementation(globalState, instruction.instruction);
+        LOG_DEBUG("Executed instruction '{}' at RIP=0x{:016x} ({})", instruction.instruction.mnemonic.mnemonicName, instructionPointer,
+                  globalState.symbolTable.symbolize(instructionPointer));
+        if (globalState.pendingIo.has_value()) {
+            // other VMs on this thread keep running until the I/O completed
+            co_await IoBackend::local().submit(*globalState.pendingIo);
+            Syscalls::completeIo(globalState.cpu, globalState.memory, *globalState.pendingIo);
+            if (syscallTracer.isEnabled()) {
+                syscallTracer.record(globalState.pendingIo->number, globalState.cpu, instructionPointer - 8, globalState.pendingIo->startTime);
             }
+            globalState.pendingIo.reset();
         }
-    }
-
-    for (LinkedInstruction& linkedInstruction : instructionList) {
-        for (Ast::Operand& operand : linkedInstruction.instruction.operands) {
-            if (std::holds_alternative<Ast::Symbol>(operand)) {
-                const auto& name = std::get<Ast::Symbol>(operand).name;
-                operand = Ast::Immediate{ resolveSymbolValue(name, globalState) };
+        if (shouldExit != 0) {
+            auto endTime = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
+            LOG_INFO("Run completed in {} ms. ({} Instructions)", duration, counter);
+            if (program.lazyFunctions.getFunctionCount() != 0) {
+                LOG_DEBUG("{} of {} functions were lowered.", program.lazyFunctions.getLoweredCount(), program.lazyFunctions.getFunctionCount());
             }
-            if (std::holds_alternative<Ast::RelativeImmediate>(operand)) {
-                auto& relativeImmediate = std::get<Ast::RelativeImmediate>(operand);
-                if (std::holds_alternative<Ast::Label>(relativeImmediate.target)) {
-                    auto name = std::get<Ast::Label>(relativeImmediate.target).name;
-
-                    const u64 targetAddress = resolveSymbolValue(name, globalState);
-                    const s64 nextInstruction = static_cast<s64>(linkedInstruction.address + 8);
-                    relativeImmediate.target = static_cast<s64>(targetAddress) - nextInstruction;
-                }
-            }
-
-            else if (std::holds_alternative<Ast::Memory>(operand)) {
-                auto& memory = std::get<Ast::Memory>(operand);
-                if (memory.disp.has_value() && std::holds_alternative<Ast::Label>(*memory.disp)) {
-                    memory.disp = static_cast<s64>(globalState.symbolTable.findSymbol(std::get<Ast::Label>(*memory.disp).name).address);
-                }
+            const PagePool::Statistics& poolStatistics = globalState.memory.getPoolStatistics();
+            LOG_INFO("Pages: {} resident, {} committed, {} allocated from pool ({} reused, {} released, {} slabs)",
+                      globalState.memory.getResidentPageCount(), globalState.memory.getCommittedPageCount(), poolStatistics.pageAllocations, poolStatistics.pageReuses,
+                      poolStatistics.pageReleases, poolStatistics.slabAllocations);
+            // output still buffered when a checkpoint ends the run belongs in the statistics
+            Syscalls::outputBuffer.flushAll();
+            for (const auto& [fd, fileStatistics] : Syscalls::outputBuffer.getStatistics()) {
+                LOG_INFO("fd {}: {} writes, {} host writes, {} bytes", fd, fileStatistics.guestWrites, fileStatistics.hostWrites,
+                         fileStatistics.bytesWritten);
             }
+            syscallTracer.finish();
+            co_return;
         }
     }
+}
 
-    // Execution
-    LOG_DEBUG("Linking completed. Starting execution...");
-
-    // init RIP
-    u64& instructionPointer = globalState.cpu.rip;
-    instructionPointer = globalState.symbolTable.findSymbol("_start").address;
-
-    // init RSP
+int run(LinkedProgram program, GlobalState& globalState) {
+    globalState.cpu.rip = program.entryPoint;
     globalState.cpu.rsp = UINT64_MAX;
 
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
-    LOG_DEBUG("Linking completed in {} ms.", duration);
-
-    startTime = std::chrono::high_resolution_clock::now();
-
-    u64 counter = 0;
-    while (true) {
-        instructionID = globalState.memory.fetchInstruction(instructionPointer);
-        counter++;
-        LinkedInstruction& instruction = instructionList[instructionID];
-        u32 shouldExit = instruction.implementation(globalState, instruction.instruction);
-        LOG_DEBUG("Executed instruction '{}' at RIP=0x{:016x}", instruction.instruction.mnemonic.mnemonicName, instructionPointer);
-        if (shouldExit != 0) {
-            endTime = std::chrono::high_resolution_clock::now();
-            duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
-            LOG_INFO("Run completed in {} ms. ({} Instructions)", duration, counter);
-            return 0;
-        }
-    }
+    Scheduler scheduler;
+    scheduler.spawn(execute(globalState, std::move(program)));
+    scheduler.run();
+    return 0;
 }
 
-} // namespace Interpreter
\ No newline at end of file
+} // namespace Interpreter
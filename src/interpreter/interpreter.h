@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <string>
 
 #include "types.h"
@@ -10,22 +11,20 @@
 #include "parser/parser.h"
 #include "testcases/loader.h"
 #include "global_state.h"
+#include "scheduler.h"
+#include "linker.h"
 
 namespace Interpreter
 {
 
-struct LinkedInstruction {
-    Ast::Instruction instruction;
-    u32 (*implementation)(GlobalState&, Ast::Instruction&);
-    u64 address;
-};
-
 u64 resolveMemory(const Ast::Memory& memory, GlobalState& globalState);
 
 Ast::Width getOperandSize(const Ast::Operand& left, std::optional<Ast::Width> suffix);
 Ast::Width getOperandSize(const Ast::Operand& left, const Ast::Operand& right, std::optional<Ast::Width> suffix);
 u64 readOperand(const Ast::Operand& operand, Ast::Width targetSize, GlobalState& globalState);
 void writeOperand(const Ast::Operand& operand, u64 value, Ast::Width targetSize, GlobalState& globalState);
-int run(Ast::Ast& ast, GlobalState& globalState);
+VmTask execute(GlobalState& globalState, LinkedProgram program);
+// Runs a program from link or from a program image, its sections have to be in the memory of globalState
+int run(LinkedProgram program, GlobalState& globalState);
 
 } // namespace Interpreter
\ No newline at end of file
@@ -0,0 +1,201 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #include <linux/io_uring.h>
+    #define ASMCUBE_HAS_IO_URING 1
+#endif
+
+#include "logging.h"
+#include "io_backend.h"
+
+namespace Interpreter
+{
+
+IoBackend::IoBackend() {
+#ifdef ASMCUBE_HAS_IO_URING
+    io_uring_params params{};
+    const s32 fd = static_cast<s32>(::syscall(__NR_io_uring_setup, QueueDepth, &params));
+    if (fd < 0) {
+        LOG_DEBUG("io_uring is unavailable (errno {}), guest I/O is performed synchronously", errno);
+        return;
+    }
+
+    submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(u32);
+    completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMapping) {
+        submissionRingSize = std::max(submissionRingSize, completionRingSize);
+        completionRingSize = submissionRingSize;
+    }
+    submissionEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+    void* submission = ::mmap(nullptr, submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    void* completion = singleMapping ? submission
+        : ::mmap(nullptr, completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    void* entries = ::mmap(nullptr, submissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (submission == MAP_FAILED || completion == MAP_FAILED || entries == MAP_FAILED) {
+        LOG_DEBUG("Failed to map the io_uring rings, guest I/O is performed synchronously");
+        if (submission != MAP_FAILED) {
+            ::munmap(submission, submissionRingSize);
+        }
+        if (!singleMapping && completion != MAP_FAILED) {
+            ::munmap(completion, completionRingSize);
+        }
+        if (entries != MAP_FAILED) {
+            ::munmap(entries, submissionEntriesSize);
+        }
+        ::close(fd);
+        return;
+    }
+
+    ringFd = fd;
+    submissionRing = static_cast<u8*>(submission);
+    completionRing = static_cast<u8*>(completion);
+    submissionEntries = entries;
+    submissionEntryCount = params.sq_entries;
+    completionEntryCount = params.cq_entries;
+
+    submissionTail = reinterpret_cast<u32*>(submissionRing + params.sq_off.tail);
+    submissionMask = reinterpret_cast<u32*>(submissionRing + params.sq_off.ring_mask);
+    submissionArray = reinterpret_cast<u32*>(submissionRing + params.sq_off.array);
+    completionHead = reinterpret_cast<u32*>(completionRing + params.cq_off.head);
+    completionTail = reinterpret_cast<u32*>(completionRing + params.cq_off.tail);
+    completionMask = reinterpret_cast<u32*>(completionRing + params.cq_off.ring_mask);
+    completionEntries = completionRing + params.cq_off.cqes;
+#endif
+}
+
+IoBackend::~IoBackend() {
+#ifdef ASMCUBE_HAS_IO_URING
+    if (ringFd < 0) {
+        return;
+    }
+    ::munmap(submissionEntries, submissionEntriesSize);
+    if (completionRing != submissionRing) {
+        ::munmap(completionRing, completionRingSize);
+    }
+    ::munmap(submissionRing, submissionRingSize);
+    ::close(ringFd);
+#endif
+}
+
+bool IoBackend::enqueue(IoRequest& request) {
+#ifdef ASMCUBE_HAS_IO_URING
+    // every submitted request needs a free completion slot, so it can never be dropped
+    if (pending >= submissionEntryCount || pending >= completionEntryCount) {
+        return false;
+    }
+
+    const u32 tail = *submissionTail;
+    const u32 index = tail & *submissionMask;
+    io_uring_sqe& entry = static_cast<io_uring_sqe*>(submissionEntries)[index];
+    entry = io_uring_sqe{};
+    entry.user_data = reinterpret_cast<u64>(&request);
+    switch (request.operation) {
+        case IoRequest::Operation::Read:
+        case IoRequest::Operation::Write:
+            entry.opcode = request.operation == IoRequest::Operation::Read ? IORING_OP_READ : IORING_OP_WRITE;
+            entry.fd = request.fd;
+            entry.addr = reinterpret_cast<u64>(request.buffer.data());
+            entry.len = static_cast<u32>(request.buffer.size());
+            // like read and write, use and advance the file position
+            entry.off = static_cast<u64>(-1);
+            break;
+
+        case IoRequest::Operation::Open:
+            entry.opcode = IORING_OP_OPENAT;
+            entry.fd = AT_FDCWD;
+            entry.addr = reinterpret_cast<u64>(request.path.c_str());
+            entry.open_flags = request.flags;
+            entry.len = request.mode;
+            break;
+    }
+    submissionArray[index] = index;
+    std::atomic_ref<u32>(*submissionTail).store(tail + 1, std::memory_order_release);
+
+    ++pending;
+    ++unsubmitted;
+    // entries the kernel did not consume yet are submitted again when waiting for completions
+    if (const s64 submitted = ::syscall(__NR_io_uring_enter, ringFd, unsubmitted, 0, 0, nullptr, 0); submitted > 0) {
+        unsubmitted -= static_cast<u32>(submitted);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void IoBackend::waitForCompletions(std::deque<std::coroutine_handle<>>& ready) {
+#ifdef ASMCUBE_HAS_IO_URING
+    if (pending == 0) {
+        return;
+    }
+    while (true) {
+        u32 head = *completionHead;
+        const u32 tail = std::atomic_ref<u32>(*completionTail).load(std::memory_order_acquire);
+        if (head != tail) {
+            for (; head != tail; ++head) {
+                const io_uring_cqe& entry = static_cast<io_uring_cqe*>(completionEntries)[head & *completionMask];
+                IoRequest& request = *reinterpret_cast<IoRequest*>(entry.user_data);
+                request.result = entry.res;
+                ready.push_back(request.waiter);
+                --pending;
+            }
+            std::atomic_ref<u32>(*completionHead).store(head, std::memory_order_release);
+            return;
+        }
+        const s64 submitted = ::syscall(__NR_io_uring_enter, ringFd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            LOG_ERROR("io_uring_enter failed with errno {}", errno);
+        }
+        if (submitted > 0) {
+            unsubmitted -= static_cast<u32>(submitted);
+        }
+    }
+#endif
+}
+
+void IoBackend::performSync(IoRequest& request) {
+    s64 result = 0;
+    switch (request.operation) {
+#ifdef _WIN32
+        case IoRequest::Operation::Read:
+            result = _read(request.fd, request.buffer.data(), static_cast<u32>(request.buffer.size()));
+            break;
+        case IoRequest::Operation::Write:
+            result = _write(request.fd, request.buffer.data(), static_cast<u32>(request.buffer.size()));
+            break;
+        case IoRequest::Operation::Open:
+            result = _open(request.path.c_str(), request.flags, request.mode);
+            break;
+#else
+        case IoRequest::Operation::Read:
+            result = ::read(request.fd, request.buffer.data(), request.buffer.size());
+            break;
+        case IoRequest::Operation::Write:
+            result = ::write(request.fd, request.buffer.data(), request.buffer.size());
+            break;
+        case IoRequest::Operation::Open:
+            result = ::open(request.path.c_str(), static_cast<s32>(request.flags), request.mode);
+            break;
+#endif
+    }
+    request.result = result < 0 ? -static_cast<s64>(errno) : result;
+}
+
+} // namespace Interpreter
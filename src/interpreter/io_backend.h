@@ -0,0 +1,123 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <coroutine>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace Interpreter
+{
+
+// Guest I/O that is handed to the host asynchronously, the buffer holds the data until the request completes
+struct IoRequest {
+    enum class Operation {
+        Read,
+        Write,
+        Open,
+    };
+
+    Operation operation;
+    s32 fd = -1;
+    u64 guestAddress = 0;
+    std::vector<u8> buffer{};
+    std::string path{};
+    u32 flags = 0;
+    u32 mode = 0;
+    s64 result = 0;
+    std::coroutine_handle<> waiter{};
+    // syscall number and submission time for the syscall trace
+    u64 number = 0;
+    u64 startTime = 0;
+};
+
+// Submits guest I/O to an io_uring ring, a VM awaiting a request is suspended until its completion is reaped.
+// Without io_uring, or with a full ring, requests are performed synchronously and the VM is not suspended.
+class IoBackend {
+    public:
+        static constexpr u32 QueueDepth = 64;
+
+        struct Awaiter {
+            IoBackend& backend;
+            IoRequest& request;
+
+            bool await_ready() {
+                if (!backend.isAsync()) {
+                    performSync(request);
+                    return true;
+                }
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                request.waiter = handle;
+                if (!backend.enqueue(request)) {
+                    performSync(request);
+                    return false;
+                }
+                return true;
+            }
+
+            s64 await_resume() const {
+                return request.result;
+            }
+        };
+
+        IoBackend();
+        ~IoBackend();
+
+        IoBackend(const IoBackend&) = delete;
+        IoBackend& operator=(const IoBackend&) = delete;
+
+        // One ring per host thread, shared by all VMs running on it
+        static IoBackend& local() {
+            thread_local IoBackend backend;
+            return backend;
+        }
+
+        bool isAsync() const {
+            return ringFd >= 0;
+        }
+
+        Awaiter submit(IoRequest& request) {
+            return Awaiter{ *this, request };
+        }
+
+        u32 getPendingCount() const {
+            return pending;
+        }
+
+        // Blocks until at least one request completed and queues the VMs waiting for them
+        void waitForCompletions(std::deque<std::coroutine_handle<>>& ready);
+
+    private:
+        s32 ringFd = -1;
+        u8* submissionRing = nullptr;
+        u64 submissionRingSize = 0;
+        u8* completionRing = nullptr;
+        u64 completionRingSize = 0;
+        void* submissionEntries = nullptr;
+        u64 submissionEntriesSize = 0;
+        u32 submissionEntryCount = 0;
+        u32 completionEntryCount = 0;
+
+        u32* submissionTail = nullptr;
+        u32* submissionMask = nullptr;
+        u32* submissionArray = nullptr;
+        u32* completionHead = nullptr;
+        u32* completionTail = nullptr;
+        u32* completionMask = nullptr;
+        void* completionEntries = nullptr;
+
+        u32 pending = 0;
+        u32 unsubmitted = 0;
+
+        bool enqueue(IoRequest& request);
+        static void performSync(IoRequest& request);
+};
+
+} // namespace Interpreter
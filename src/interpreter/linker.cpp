@@ -0,0 +1,559 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <future>
+#include <span>
+
+#include "thread_pool.h"
+#include "parser/parser.h"
+#include "interpreter.h"
+#include "linker.h"
+#include "mnemonics.h"
+
+namespace Interpreter
+{
+
+std::vector<u8> decodeAscii(const std::string_view text) {
+    std::vector<u8> result;
+    for (u32 i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\') {
+            switch (text[i + 1]) {
+                case 'n':
+                    result.push_back('\n');
+                    ++i;
+                    break;
+
+                case '0':
+                    result.push_back('\0');
+                    ++i;
+                    break;
+
+                default:
+                    LOG_ERROR("Unknown escape sequence in string '{}'", text);
+            }
+        }
+        else {
+            result.push_back(static_cast<u8>(text[i]));
+        }
+    }
+    return result;
+}
+
+namespace {
+
+// Operand width and implementation, everything of an instruction that does not depend on other symbols
+void lowerInstruction(LinkedInstruction& linkedInstruction) {
+    Ast::Instruction& instruction = linkedInstruction.instruction;
+    if (instruction.operands.size() == 1) {
+        instruction.operandWidth = getOperandSize(instruction.operands[0], instruction.mnemonic.width);
+    }
+    else if (instruction.operands.size() == 2) {
+        instruction.operandWidth = getOperandSize(instruction.operands[0], instruction.operands[1], instruction.mnemonic.width);
+    }
+    linkedInstruction.implementation = Mnemonics::instructionDefinitions.find(instruction.mnemonic.mnemonicName)->implementation;
+}
+
+// Returns the first relocation with an undefined symbol, the relocation count if there is none
+u64 applyRelocations(const std::span<const Relocation> relocations, std::vector<LinkedInstruction>& instructionList, const SymbolTable& symbolTable) {
+    for (u64 i = 0; i < relocations.size(); ++i) {
+        const Relocation& relocation = relocations[i];
+        if (!symbolTable.hasSymbol(relocation.symbol)) {
+            return i;
+        }
+        const u64 value = symbolTable.get(relocation.symbol).address;
+        LinkedInstruction& linkedInstruction = instructionList[relocation.instruction];
+        Ast::Operand& operand = linkedInstruction.instruction.operands[relocation.operand];
+        switch (relocation.type) {
+            case Relocation::Type::Absolute:
+                operand = Ast::Immediate{ value };
+                break;
+
+            case Relocation::Type::Relative:
+                std::get<Ast::RelativeImmediate>(operand).target = static_cast<s64>(value) - static_cast<s64>(linkedInstruction.address + 8);
+                break;
+
+            case Relocation::Type::Displacement:
+                std::get<Ast::Memory>(operand).disp = static_cast<s64>(value);
+                break;
+        }
+    }
+    return relocations.size();
+}
+
+} // namespace
+
+void LazyFunctions::lower(std::vector<LinkedInstruction>& instructions, const u64 index, const SymbolTable& symbolTable) {
+    const auto it = std::ranges::upper_bound(functions, index, {}, &Function::firstInstruction);
+    if (it == functions.begin()) {
+        LOG_ERROR("Instruction {} does not belong to any function", index);
+    }
+    const Function& function = *std::prev(it);
+    const u64 instructionEnd = it != functions.end() ? it->firstInstruction : instructions.size();
+    const u64 relocationEnd = it != functions.end() ? it->firstRelocation : relocations.size();
+
+    for (u64 i = function.firstInstruction; i < instructionEnd; ++i) {
+        lowerInstruction(instructions[i]);
+    }
+    const std::span<const Relocation> functionRelocations(relocations.data() + function.firstRelocation, relocations.data() + relocationEnd);
+    if (const u64 failed = applyRelocations(functionRelocations, instructions, symbolTable); failed != functionRelocations.size()) {
+        LOG_ERROR("Unknown symbol '{}'", symbolTable.getName(functionRelocations[failed].symbol));
+    }
+    ++loweredCount;
+}
+
+Linker::Linker(GlobalState& globalState, const StringPool& names, const LinkOptions options)
+    : globalState(globalState), names(&names), options(options), sectionEnds(options.sectionBases) {
+    LOG_DEBUG("Start linking...");
+    globalState.symbolTable.setAddressPointer(sectionEnds[static_cast<u32>(outputSection)]);
+    startTime = std::chrono::high_resolution_clock::now();
+}
+
+SymbolTable::Id Linker::getSymbolId(const Ast::NameId name) {
+    constexpr SymbolTable::Id Unmapped = ~SymbolTable::Id{ 0 };
+    if (name >= symbolIds.size()) {
+        symbolIds.resize(names->size(), Unmapped);
+    }
+    if (symbolIds[name] == Unmapped) {
+        symbolIds[name] = internName(names->get(name));
+    }
+    return symbolIds[name];
+}
+
+SymbolTable::Id Linker::internName(const std::string_view name) {
+    if (!localNames.empty()) {
+        if (const std::optional<Ast::NameId> id = names->find(name); id.has_value() && localNames[*id]) {
+            // the object name goes last, so local labels like .L2 keep their leading '.'
+            return globalState.symbolTable.intern(std::format("{}:{}", name, objectName));
+        }
+    }
+    return globalState.symbolTable.intern(name);
+}
+
+SymbolTable::Id Linker::getReferenceId(const Ast::NameId name) {
+    if (const std::string_view text = names->get(name); text.find('@') != std::string_view::npos) {
+        return internName(text.substr(0, text.find('@')));
+    }
+    return getSymbolId(name);
+}
+
+void Linker::addRelocations(const Ast::Instruction& instruction, const u32 index) {
+    for (u8 i = 0; i < instruction.operands.size(); ++i) {
+        const Ast::Operand& operand = instruction.operands[i];
+        if (std::holds_alternative<Ast::Symbol>(operand)) {
+            relocations.push_back(Relocation{ index, i, Relocation::Type::Absolute, getReferenceId(std::get<Ast::Symbol>(operand).name) });
+        }
+        else if (std::holds_alternative<Ast::RelativeImmediate>(operand)) {
+            const auto& target = std::get<Ast::RelativeImmediate>(operand).target;
+            if (std::holds_alternative<Ast::Label>(target)) {
+                relocations.push_back(Relocation{ index, i, Relocation::Type::Relative, getReferenceId(std::get<Ast::Label>(target).name) });
+            }
+        }
+        else if (std::holds_alternative<Ast::Memory>(operand)) {
+            const auto& disp = std::get<Ast::Memory>(operand).disp;
+            if (disp.has_value() && std::holds_alternative<Ast::Label>(*disp)) {
+                relocations.push_back(Relocation{ index, i, Relocation::Type::Displacement, getReferenceId(std::get<Ast::Label>(*disp).name) });
+            }
+        }
+    }
+}
+
+void Linker::beginObject(const Ast::Ast& ast, const std::string_view objectName) {
+    names = &ast.getNames();
+    this->objectName = objectName;
+    symbolIds.clear();
+    localNames.assign(names->size(), false);
+    for (const Ast::Section& section : ast.getSections()) {
+        for (const Ast::Item& item : section.items) {
+            if (const auto* label = std::get_if<Ast::Label>(&item)) {
+                localNames[label->name] = true;
+            }
+            else if (const auto* symbolAssignment = std::get_if<Ast::SymbolAssignment>(&item)) {
+                localNames[symbolAssignment->name] = true;
+            }
+        }
+    }
+    for (const Ast::Section& section : ast.getSections()) {
+        for (const Ast::Item& item : section.items) {
+            const auto* directive = std::get_if<Ast::Directive>(&item);
+            if (directive == nullptr || (directive->name != Ast::Directive::Name::globl && directive->name != Ast::Directive::Name::global)) {
+                continue;
+            }
+            for (const std::string_view name : directive->arguments) {
+                if (const std::optional<Ast::NameId> id = names->find(name); id.has_value()) {
+                    localNames[*id] = false;
+                }
+            }
+        }
+    }
+
+    // every file starts out in .text like it does for an assembler
+    SymbolTable& symbolTable = globalState.symbolTable;
+    sectionEnds[static_cast<u32>(outputSection)] = symbolTable.getAddressPointer();
+    outputSection = OutputSection::Text;
+    symbolTable.setAddressPointer(sectionEnds[static_cast<u32>(outputSection)]);
+    currentSymbol = symbolTable.intern("");
+}
+
+void Linker::beginSection(const Ast::Section& section) {
+    std::string_view name = names->get(section.name);
+    if (name[0] == '.') {
+        name = name.substr(1);
+    }
+    // sub-sections like .rodata.str1.1 are merged into their output section
+    const auto isSection = [name](const std::string_view outputName) {
+        return name == outputName || (name.starts_with(outputName) && name[outputName.size()] == '.');
+    };
+    OutputSection next = OutputSection::Data;
+    if (isSection("rodata")) {
+        next = OutputSection::ReadOnlyData;
+    }
+    else if (isSection("data")) {
+        next = OutputSection::Data;
+    }
+    else if (isSection("bss")) {
+        next = OutputSection::Bss;
+    }
+    else if (isSection("text")) {
+        next = OutputSection::Text;
+    }
+    else {
+        LOG_INFO("Unknown section name '{}', it is placed in .data", name);
+    }
+
+    SymbolTable& symbolTable = globalState.symbolTable;
+    sectionEnds[static_cast<u32>(outputSection)] = symbolTable.getAddressPointer();
+    outputSection = next;
+    symbolTable.setAddressPointer(sectionEnds[static_cast<u32>(outputSection)]);
+    currentSymbol = symbolTable.intern("");
+}
+
+void Linker::addItem(const Ast::Item& item) {
+    switch (item.index()) {
+        case 0:
+            {
+                // Label
+                currentSymbol = getSymbolId(std::get<Ast::Label>(item).name);
+                break;
+            }
+
+        case 1:
+            {
+                // Directive
+                const Ast::Directive& directive = std::get<Ast::Directive>(item);
+                switch (directive.name) {
+                    case Ast::Directive::Name::ascii:
+                        {
+                            auto buffer = decodeAscii(directive.arguments[0]);
+                            Symbol& symbol = globalState.symbolTable.addSymbol(currentSymbol, buffer.size());
+                            std::ranges::copy(buffer, emit(symbol.address, buffer.size()));
+                        }
+                        break;
+
+                    case Ast::Directive::Name::asciz:
+                        {
+                            auto buffer = decodeAscii(directive.arguments[0]);
+                            buffer.push_back('\0');
+                            Symbol& symbol = globalState.symbolTable.addSymbol(currentSymbol, buffer.size());
+                            std::ranges::copy(buffer, emit(symbol.address, buffer.size()));
+                        }
+                        break;
+
+                    case Ast::Directive::Name::skip:
+                    case Ast::Directive::Name::space:
+                        {
+                            u32 size = std::stoull(std::string(directive.arguments[0]));
+                            u64 data = 0u;
+                            if (directive.arguments.size() > 1) {
+                                data = Parser::textToNumber(directive.arguments[1]);
+                            }
+                            Symbol& symbol = globalState.symbolTable.addSymbol(currentSymbol, size);
+                            // zero fill only moves the address pointer, the space is never emitted
+                            if (data != 0) {
+                                std::fill_n(emit(symbol.address, size), size, static_cast<u8>(data));
+                            }
+                        }
+                        break;
+
+                    case Ast::Directive::Name::zero:
+                        {
+                            u32 size = std::stoull(std::string(directive.arguments[0]));
+                            globalState.symbolTable.addSymbol(currentSymbol, size);
+                        }
+                        break;
+
+                    case Ast::Directive::Name::byte:
+                        {
+                            u32 size = directive.arguments.size();
+                            Symbol symbol;
+                            if (globalState.symbolTable.hasSymbol(currentSymbol)) {
+                                symbol = globalState.symbolTable.extendSymbol(currentSymbol, size);
+                            }
+                            else {
+                                symbol = globalState.symbolTable.addSymbol(currentSymbol, size);
+                            }
+                            u8* data = emit(symbol.address, size);
+                            for (u32 i = 0; i < size; ++i) {
+                                data[i] = static_cast<u8>(Parser::textToNumber(directive.arguments[i]));
+                            }
+                        }
+                        break;
+
+                    case Ast::Directive::Name::quad:
+                        {
+                            u32 size = directive.arguments.size() * 8;
+                            Symbol symbol;
+                            if (globalState.symbolTable.hasSymbol(currentSymbol)) {
+                                symbol = globalState.symbolTable.extendSymbol(currentSymbol, size);
+                            }
+                            else {
+                                symbol = globalState.symbolTable.addSymbol(currentSymbol, size);
+                            }
+                            u8* data = emit(symbol.address, size);
+                            for (u32 i = 0; i < directive.arguments.size(); ++i) {
+                                auto& text = directive.arguments[i];
+                                if (Parser::isNumber(text) || Parser::isHexNumber(text)) {
+                                    const u64 value = Parser::textToNumber(text);
+                                    std::memcpy(data + i * 8, &value, 8);
+                                }
+                                else {
+                                    // the symbol may be defined further down, it is patched in by finish
+                                    const u64 offset = symbol.address + i * 8 - options.sectionBases[static_cast<u32>(outputSection)];
+                                    dataPatches.push_back(DataPatch{ outputSection, offset, internName(text) });
+                                }
+                            }
+                        }
+                        break;
+
+                    default:
+                        break;
+                }
+                break;
+            }
+
+        case 2:
+            {
+                if (outputSection != OutputSection::Text) {
+                    LOG_ERROR("Instructions can only be in the .text section");
+                }
+
+                Symbol symbol;
+                if (globalState.symbolTable.hasSymbol(currentSymbol)) {
+                    symbol = globalState.symbolTable.extendSymbol(currentSymbol, 8);
+                }
+                else {
+                    symbol = globalState.symbolTable.addSymbol(currentSymbol, 8);
+                }
+
+                if (options.lazy && currentSymbol != instructionSymbol) {
+                    // local labels like .L2 stay in the function of the label before them
+                    if (functions.empty() || !globalState.symbolTable.getName(currentSymbol).starts_with('.')) {
+                        functions.push_back(LazyFunctions::Function{ static_cast<u32>(instructionList.size()), static_cast<u32>(relocations.size()) });
+                    }
+                    instructionSymbol = currentSymbol;
+                }
+
+                // a plain copy, names are IDs and the operands are stored inline
+                LinkedInstruction& linkedInstruction = instructionList.emplace_back(std::get<Ast::Instruction>(item), nullptr, symbol.address);
+                if (!options.lazy) {
+                    lowerInstruction(linkedInstruction);
+                }
+                addRelocations(linkedInstruction.instruction, static_cast<u32>(instructionList.size() - 1));
+                std::memcpy(emit(symbol.address, 8), &instructionID, 8);
+                ++instructionID;
+                break;
+            }
+        case 3:
+            {
+                // SymbolAssignment
+                const Ast::SymbolAssignment& symbolAssignment = std::get<Ast::SymbolAssignment>(item);
+                const std::span<const Token> tokens = symbolAssignment.expression.tokens;
+                if (tokens[0].type == Token::Type::Dot && tokens[1].type == Token::Type::Dash) {
+                    const SymbolTable::Id other = internName(tokens[2].lexeme);
+                    if (!globalState.symbolTable.hasSymbol(other)) {
+                        LOG_ERROR("Symbol '{}' not found!", tokens[2].lexeme);
+                    }
+                    globalState.symbolTable.setImmediate(getSymbolId(symbolAssignment.name), globalState.symbolTable.get(other).size);
+                }
+                break;
+            }
+    }
+}
+
+u8* Linker::emit(const u64 address, const u64 size) {
+    std::vector<u8>& data = sectionData[static_cast<u32>(outputSection)];
+    const u64 offset = address - options.sectionBases[static_cast<u32>(outputSection)];
+    if (data.size() < offset + size) {
+        data.resize(offset + size);
+    }
+    return data.data() + offset;
+}
+
+void Linker::installSections() {
+    const SymbolTable& symbolTable = globalState.symbolTable;
+    for (const DataPatch& patch : dataPatches) {
+        if (!symbolTable.hasSymbol(patch.symbol)) {
+            LOG_ERROR("Symbol '{}' not found!", symbolTable.getName(patch.symbol));
+        }
+        const u64 value = symbolTable.get(patch.symbol).address;
+        std::memcpy(sectionData[static_cast<u32>(patch.section)].data() + patch.offset, &value, 8);
+    }
+
+    Memory& memory = globalState.memory;
+    for (u32 i = 0; i < OutputSectionCount; ++i) {
+        const u64 base = options.sectionBases[i];
+        if (sectionEnds[i] == base) {
+            continue;
+        }
+        memory.mapSection(base, sectionEnds[i] - base, outputSectionPermissions[i]);
+
+        // pages become views into the buffer, pages without data stay on the shared zero page
+        auto data = std::make_shared<std::vector<u8>>(std::move(sectionData[i]));
+        data->resize(alignToPage(data->size()));
+        for (u64 offset = 0; offset < data->size(); offset += PageSize) {
+            u8* page = data->data() + offset;
+            if (std::any_of(page, page + PageSize, [](const u8 byte) { return byte != 0; })) {
+                memory.mapSectionPage((base + offset) / PageSize, page);
+            }
+        }
+        memory.keepAlive(std::shared_ptr<u8>(data, data->data()));
+    }
+}
+
+LinkedProgram Linker::finish() {
+    // every output section grows towards the base of the one above it
+    sectionEnds[static_cast<u32>(outputSection)] = globalState.symbolTable.getAddressPointer();
+    for (u32 i = 0; i < OutputSectionCount; ++i) {
+        for (u32 j = 0; j < OutputSectionCount; ++j) {
+            const u64 base = options.sectionBases[j];
+            if (i != j && options.sectionBases[i] <= base && base < sectionEnds[i]) {
+                LOG_ERROR("Section {} ends at 0x{:x} and overlaps {} at 0x{:x}, move it with --sectionBases",
+                          outputSectionNames[i], sectionEnds[i], outputSectionNames[j], base);
+            }
+        }
+    }
+    installSections();
+    globalState.memory.initProgramBreak();
+    if (!globalState.symbolTable.hasSymbol("_start")) {
+        LOG_ERROR("No entry point '_start' found, with several input files it has to be declared with .globl _start");
+    }
+    const u64 entryPoint = globalState.symbolTable.findSymbol("_start").address;
+
+    if (options.lazy) {
+        auto endTime = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
+        LOG_DEBUG("Linking completed in {} ms, {} functions are lowered when they first run.", duration, functions.size());
+        return LinkedProgram{ std::move(instructionList), entryPoint, LazyFunctions(std::move(functions), std::move(relocations)) };
+    }
+
+    // relocations only write to their own operand, so batches never touch the same data
+    const SymbolTable& symbolTable = globalState.symbolTable;
+    u64 failed = relocations.size();
+    if (relocations.size() > RelocationBatchSize && options.threadCount != 1) {
+        ThreadPool pool(options.threadCount);
+        std::vector<std::future<u64>> batches;
+        for (u64 begin = 0; begin < relocations.size(); begin += RelocationBatchSize) {
+            const std::span<const Relocation> batch = std::span(relocations).subspan(begin, std::min<u64>(RelocationBatchSize, relocations.size() - begin));
+            batches.push_back(pool.submit([this, batch, begin, &symbolTable] {
+                const u64 batchFailed = applyRelocations(batch, instructionList, symbolTable);
+                return batchFailed == batch.size() ? relocations.size() : begin + batchFailed;
+            }));
+        }
+        for (std::future<u64>& batch : batches) {
+            failed = std::min(failed, batch.get());
+        }
+    }
+    else {
+        failed = applyRelocations(relocations, instructionList, symbolTable);
+    }
+    if (failed != relocations.size()) {
+        LOG_ERROR("Unknown symbol '{}'", symbolTable.getName(relocations[failed].symbol));
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
+    LOG_DEBUG("Linking completed in {} ms, {} relocations applied.", duration, relocations.size());
+    return LinkedProgram{ std::move(instructionList), entryPoint };
+}
+
+bool parseSectionBases(const std::string_view text, SectionBases& bases) {
+    for (u64 start = 0; start < text.size();) {
+        const u64 end = std::min(text.find(',', start), text.size());
+        const std::string_view entry = text.substr(start, end - start);
+        start = end + 1;
+
+        const u64 separator = entry.find('=');
+        if (separator == std::string_view::npos) {
+            return false;
+        }
+        const auto name = std::ranges::find(outputSectionNames, entry.substr(0, separator));
+        const std::string_view address = entry.substr(separator + 1);
+        if (name == outputSectionNames.end() || !(Parser::isNumber(address) || Parser::isHexNumber(address))) {
+            return false;
+        }
+        const u64 base = Parser::textToNumber(address);
+        // the first page stays unmapped, so null pointer accesses still fault
+        if (base % PageSize != 0 || base < PageSize || base >= StackBase) {
+            return false;
+        }
+        bases[name - outputSectionNames.begin()] = base;
+    }
+    return true;
+}
+
+LinkedProgram link(Ast::Ast& ast, GlobalState& globalState, const LinkOptions options) {
+    Linker linker(globalState, ast.getNames(), options);
+    for (const Ast::Section& section : ast.getSections()) {
+        linker.beginSection(section);
+        for (const Ast::Item& item : section.items) {
+            linker.addItem(item);
+        }
+    }
+    return linker.finish();
+}
+
+LinkedProgram link(const std::span<const ObjectFile> objects, GlobalState& globalState, const LinkOptions options) {
+    Linker linker(globalState, objects.front().ast->getNames(), options);
+    for (const ObjectFile& object : objects) {
+        linker.beginObject(*object.ast, object.name);
+        for (const Ast::Section& section : object.ast->getSections()) {
+            linker.beginSection(section);
+            for (const Ast::Item& item : section.items) {
+                linker.addItem(item);
+            }
+        }
+    }
+    return linker.finish();
+}
+
+LinkedProgram link(Lexer& lexer, GlobalState& globalState, const LinkOptions options) {
+    // only holds the section that is being parsed and the items of the current line
+    Ast::Ast ast;
+    Linker linker(globalState, ast.getNames(), options);
+    std::vector<Token> lineTokens;
+    while (lexer.nextLine(lineTokens)) {
+        std::pmr::vector<Ast::Section>& sections = ast.getSections();
+        const u64 sectionCount = sections.size();
+        Parser::parseLine(lineTokens, ast);
+        lineTokens.clear();
+        if (sections.empty()) {
+            continue;
+        }
+        if (sections.size() != sectionCount) {
+            // the parser only ever appends to the last section
+            linker.beginSection(sections.back());
+        }
+        for (const Ast::Item& item : sections.back().items) {
+            linker.addItem(item);
+        }
+        // nothing the linker keeps points into the arena, so the line is dropped in one go
+        const Ast::NameId sectionName = sections.back().name;
+        ast.reset();
+        ast.addSection(sectionName);
+    }
+    return linker.finish();
+}
+
+} // namespace Interpreter
@@ -0,0 +1,192 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "string_pool.h"
+#include "types.h"
+#include "global_state.h"
+#include "lexer/lexer.h"
+#include "parser/ast.h"
+
+namespace Interpreter
+{
+
+struct LinkedInstruction {
+    Ast::Instruction instruction;
+    u32 (*implementation)(GlobalState&, Ast::Instruction&);
+    u64 address;
+};
+
+// An operand that refers to a symbol. Recorded while the layout is built and applied once every symbol has its address.
+struct Relocation {
+    enum class Type : u8 {
+        Absolute,     // symbol operand, becomes an immediate with the symbol's value
+        Relative,     // label target of a jump or call, becomes relative to the next instruction
+        Displacement, // label displacement of a memory operand
+    };
+
+    u32 instruction; // index in the instruction list
+    u8 operand;
+    Type type;
+    SymbolTable::Id symbol;
+};
+
+// Functions of a lazily linked program that have not run yet. Their addresses and symbols are final, only the
+// operand widths, implementations and relocations of their instructions are missing. The interpreter lowers a
+// function the first time it fetches one of its instructions, which it recognizes by the missing implementation.
+class LazyFunctions {
+    public:
+        struct Function {
+            u32 firstInstruction;
+            // relocations are recorded in instruction order, so every function has a contiguous range of them
+            u32 firstRelocation;
+        };
+
+        LazyFunctions() = default;
+        LazyFunctions(std::vector<Function> functions, std::vector<Relocation> relocations)
+            : functions(std::move(functions)), relocations(std::move(relocations)) {}
+
+        // Lowers the function that contains the instruction at index
+        void lower(std::vector<LinkedInstruction>& instructions, u64 index, const SymbolTable& symbolTable);
+
+        u64 getFunctionCount() const {
+            return functions.size();
+        }
+
+        u64 getLoweredCount() const {
+            return loweredCount;
+        }
+
+    private:
+        std::vector<Function> functions;
+        std::vector<Relocation> relocations;
+        u64 loweredCount = 0;
+};
+
+// A program that is ready to run, its sections are already laid out in guest memory
+struct LinkedProgram {
+    // indexed by instruction ID
+    std::vector<LinkedInstruction> instructions;
+    u64 entryPoint;
+    // empty unless the program was linked lazily
+    LazyFunctions lazyFunctions{};
+};
+
+// Input sections are merged by name into these, .text.hot ends up in Text
+enum class OutputSection : u8 {
+    Text,
+    ReadOnlyData,
+    Data,
+    Bss,
+};
+
+inline constexpr u32 OutputSectionCount = 4;
+inline constexpr std::array<std::string_view, OutputSectionCount> outputSectionNames = { "text", "rodata", "data", "bss" };
+inline constexpr std::array<Permission, OutputSectionCount> outputSectionPermissions = {
+    Permission{ true, false, true },
+    Permission{ true, false, false },
+    Permission{ true, true, false },
+    Permission{ true, true, false },
+};
+
+// Page aligned start of each output section, so no page holds bytes of two sections and every page has
+// one permission. A section may grow up to the base of the next one, the defaults leave 256 MiB each
+// and stay below 2 GiB like a non-PIE executable.
+using SectionBases = std::array<u64, OutputSectionCount>;
+inline constexpr SectionBases DefaultSectionBases = { 0x400000, 0x10000000, 0x20000000, 0x30000000 };
+
+// Reads a list like 'text=0x400000,data=0x600000', sections that are not listed keep their base.
+// Bases have to be page aligned, above the first page and below the stack.
+bool parseSectionBases(std::string_view text, SectionBases& bases);
+
+struct LinkOptions {
+    // threads of the fixup pass, 0 uses every core
+    u32 threadCount = 0;
+    // only lays out sections and symbols up front, every function is lowered and relocated when it first runs
+    bool lazy = false;
+    SectionBases sectionBases = DefaultSectionBases;
+};
+
+// Relocations applied by one job of the fixup pass, programs with fewer are fixed up on the calling thread
+inline constexpr u64 RelocationBatchSize = 64 * 1024;
+
+// Lays out sections and items in guest memory in the order the parser emits them. Symbols may be
+// used before their definition, so operands referring to them are only recorded as relocations and
+// patched once the input is complete.
+class Linker {
+    public:
+        // names has to be the pool of the AST the items come from
+        Linker(GlobalState& globalState, const StringPool& names, LinkOptions options = {});
+
+        // Starts the next input file of a program made of several, its sections and names come from ast.
+        // Labels it does not declare with .globl or .global are only visible inside it.
+        void beginObject(const Ast::Ast& ast, std::string_view objectName);
+        void beginSection(const Ast::Section& section);
+        void addItem(const Ast::Item& item);
+        // Applies the relocations in batches on the threads of the options, lazily linked programs keep them
+        LinkedProgram finish();
+
+    private:
+        // A .quad that holds the address of a symbol
+        struct DataPatch {
+            OutputSection section;
+            u64 offset; // from the base of the section
+            SymbolTable::Id symbol;
+        };
+
+        GlobalState& globalState;
+        const StringPool* names;
+        LinkOptions options;
+        std::vector<LinkedInstruction> instructionList{};
+        std::vector<Relocation> relocations;
+        std::vector<LazyFunctions::Function> functions;
+        // label of the last instruction, a new non-local one starts a function
+        SymbolTable::Id instructionSymbol = ~SymbolTable::Id{ 0 };
+        u64 instructionID = 0;
+        OutputSection outputSection = OutputSection::Text;
+        // address pointer of every output section, the symbol table only holds the one of the current section
+        std::array<u64, OutputSectionCount> sectionEnds;
+        // bytes of every output section from its base up to the last one that was emitted, the rest is zero
+        std::array<std::vector<u8>, OutputSectionCount> sectionData;
+        std::vector<DataPatch> dataPatches;
+        // the label data and instructions are added to
+        SymbolTable::Id currentSymbol = 0;
+        // symbol table ID for each name of the AST, names are only hashed the first time they come up
+        std::vector<SymbolTable::Id> symbolIds;
+        // labels of the current object that are not global, they are interned as 'name:objectName'
+        std::vector<bool> localNames;
+        std::string_view objectName;
+        std::chrono::high_resolution_clock::time_point startTime;
+
+        SymbolTable::Id getSymbolId(Ast::NameId name);
+        SymbolTable::Id internName(std::string_view name);
+        // Symbol a reference resolves to, '@' suffixes like '@PLT' are ignored
+        SymbolTable::Id getReferenceId(Ast::NameId name);
+        void addRelocations(const Ast::Instruction& instruction, u32 index);
+        // The bytes of the current section at address, the buffer grows to hold them
+        u8* emit(u64 address, u64 size);
+        // Patches the .quad symbols and maps every section with its pages in one step
+        void installSections();
+};
+
+// An input file of a program that is made of several
+struct ObjectFile {
+    std::string_view name;
+    const Ast::Ast* ast;
+};
+
+LinkedProgram link(Ast::Ast& ast, GlobalState& globalState, LinkOptions options = {});
+// Lays out the objects one after the other, sections of the same kind are merged in the order of the objects
+LinkedProgram link(std::span<const ObjectFile> objects, GlobalState& globalState, LinkOptions options = {});
+// Lexes, parses and links line by line without building the whole token list or AST
+LinkedProgram link(Lexer& lexer, GlobalState& globalState, LinkOptions options = {});
+
+} // namespace Interpreter
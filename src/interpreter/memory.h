@@ -3,10 +3,16 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <bitset>
 #include <cstring>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "logging.h"
 #include "types.h"
@@ -17,41 +23,591 @@ namespace Interpreter
 constexpr u32 PageSize = 4_KiB;
 
 struct Page {
-    std::array<u8, PageSize> data {};
+    u8* data = nullptr; // either storage or a host file mapping
+    std::array<u8, PageSize> storage;
     std::bitset<PageSize> initialized {};
     std::bitset<PageSize> permissionRead {};
     std::bitset<PageSize> permissionWrite {};
     std::bitset<PageSize> permissionExecute {};
 };
 
+// Hands out pages from slabs and recycles released pages through a free list,
+// so short-lived Memory instances don't go through the global allocator for every page
+class PagePool {
+    public:
+        struct Statistics {
+            u64 slabAllocations = 0;
+            u64 pageAllocations = 0;
+            u64 pageReuses = 0;
+            u64 pageReleases = 0;
+        };
+
+        static constexpr u32 PagesPerSlab = 64;
+
+        // Pages have to be released to the pool they were allocated from, which is why
+        // a Memory must not outlive the thread that created it
+        static PagePool& local() {
+            thread_local PagePool pool;
+            return pool;
+        }
+
+        // The storage of the returned page is not cleared, the caller either maps it or calls useStorage
+        Page* allocate() {
+            ++statistics.pageAllocations;
+            if (!freeList.empty()) {
+                ++statistics.pageReuses;
+                Page* page = freeList.back();
+                freeList.pop_back();
+                page->initialized.reset();
+                page->permissionRead.reset();
+                page->permissionWrite.reset();
+                page->permissionExecute.reset();
+                return page;
+            }
+
+            if (slabs.empty() || nextFreshPage == PagesPerSlab) {
+                ++statistics.slabAllocations;
+                slabs.push_back(std::make_unique_for_overwrite<Page[]>(PagesPerSlab));
+                nextFreshPage = 0;
+            }
+            return &slabs.back()[nextFreshPage++];
+        }
+
+        void release(Page* page) {
+            ++statistics.pageReleases;
+            page->data = nullptr;
+            freeList.push_back(page);
+        }
+
+        static void useStorage(Page& page) {
+            page.storage.fill(0);
+            page.data = page.storage.data();
+        }
+
+        const Statistics& getStatistics() const {
+            return statistics;
+        }
+
+        u64 getFreePageCount() const {
+            return freeList.size() + (slabs.empty() ? 0 : PagesPerSlab - nextFreshPage);
+        }
+
+    private:
+        std::vector<std::unique_ptr<Page[]>> slabs;
+        u32 nextFreshPage = 0;
+        std::vector<Page*> freeList;
+        Statistics statistics{};
+};
+
 struct Permission {
     bool read = false;
     bool write = false;
     bool execute = false;
+
+    bool operator==(const Permission&) const = default;
 };
 
+struct Region {
+    enum class Kind {
+        Section,
+        Stack,
+        Heap,
+        Anonymous,
+        File,
+    };
+
+    u64 start;
+    u64 length;
+    Permission permission;
+    Kind kind;
+
+    // host file mapping backing a file region, pages beyond backingSize raise a bus error
+    std::shared_ptr<u8> backing {};
+    u64 backingSize = 0;
+    bool backingWritable = false;
+
+    bool contains(const u64 address) const {
+        return address - start < length; // also correct for regions ending at 2^64
+    }
+};
+
+// Guest memory written by a bulk transfer, collected while a syscall is recorded
+struct CapturedWrite {
+    u64 address;
+    std::vector<u8> data;
+};
+
+constexpr u64 StackSize = 8_MiB;
+constexpr u64 StackBase = 0 - StackSize;
+
+constexpr u64 alignToPage(const u64 value) {
+    return (value + PageSize - 1) & ~static_cast<u64>(PageSize - 1);
+}
+
 class Memory {
     private:
-        std::unordered_map<u64, Page> pages;
+        PagePool& pool = PagePool::local();
+        std::unordered_map<u64, Page*> pages;
         u64 lastPageIndex = UINT64_MAX;
         Page* lastPage = nullptr;
         u64 lastCodePageIndex = UINT64_MAX;
         Page* lastCodePage = nullptr;
 
+        std::map<u64, Region> regions;
+        u64 heapStart = 0;
+        u64 programBreak = 0;
+
+        std::vector<CapturedWrite>* capturedWrites = nullptr;
+
+        // host memory that committed pages point into, like a mapped program image
+        std::vector<std::shared_ptr<u8>> hostMappings;
+
+        static void applyPermission(Page& page, const u64 offset, const u64 count, const Permission permission) {
+            if (offset == 0 && count == PageSize) {
+                permission.read ? page.permissionRead.set() : page.permissionRead.reset();
+                permission.write ? page.permissionWrite.set() : page.permissionWrite.reset();
+                permission.execute ? page.permissionExecute.set() : page.permissionExecute.reset();
+                return;
+            }
+
+            for (u64 n = 0; n < count; ++n) {
+                page.permissionRead.set(offset + n, permission.read);
+                page.permissionWrite.set(offset + n, permission.write);
+                page.permissionExecute.set(offset + n, permission.execute);
+            }
+        }
+
+        static void markInitialized(Page& page, const u64 offset, const u64 count) {
+            if (offset == 0 && count == PageSize) {
+                page.initialized.set();
+                return;
+            }
+            for (u64 n = 0; n < count; ++n) {
+                page.initialized.set(offset + n);
+            }
+        }
+
+        static bool allSet(const std::bitset<PageSize>& bits, const u64 offset, const u64 count) {
+            if (offset == 0 && count == PageSize) {
+                return bits.all();
+            }
+            for (u64 n = 0; n < count; ++n) {
+                if (!bits.test(offset + n)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Calls function(address, offset, count) for the part of the range in each page
+        template <typename Function>
+        static bool forEachChunk(const u64 address, const u64 size, Function function) {
+            u64 done = 0;
+            while (done < size) {
+                const u64 current = address + done;
+                const u64 offset = current % PageSize;
+                const u64 count = std::min(size - done, PageSize - offset);
+                if (!function(current, offset, count, done)) {
+                    return false;
+                }
+                done += count;
+            }
+            return true;
+        }
+
+        // Only stack memory starts out uninitialized, everything else is zero-filled or loaded
+        static bool isZeroInitialized(const Region::Kind kind) {
+            return kind != Region::Kind::Stack;
+        }
+
+        // One shared, read-only zero page per permission combination backs all untouched pages
+        static const Page& zeroPage(const Permission permission, const bool initialized) {
+            static std::array<u8, PageSize> zeroData {};
+            static const std::array<Page, 16> zeroPages = [] {
+                std::array<Page, 16> result {};
+                for (u32 i = 0; i < result.size(); ++i) {
+                    result[i].data = zeroData.data();
+                    applyPermission(result[i], 0, PageSize, Permission{ (i & 1) != 0, (i & 2) != 0, (i & 4) != 0 });
+                    if ((i & 8) != 0) {
+                        result[i].initialized.set();
+                    }
+                }
+                return result;
+            }();
+            return zeroPages[permission.read | permission.write << 1 | permission.execute << 2 | initialized << 3];
+        }
+
+        // Returns nullptr if the page is not covered uniformly and has to be materialized to be read
+        const Page* findZeroPage(const u64 pageIndex) const {
+            const u64 pageStart = pageIndex * PageSize;
+            const Region* region = findRegion(pageStart);
+            if (region == nullptr) {
+                return isRangeFree(pageStart, PageSize) ? &zeroPage(Permission{}, false) : nullptr;
+            }
+            if (region->kind == Region::Kind::File || region->length - (pageStart - region->start) < PageSize) {
+                return nullptr;
+            }
+            return &zeroPage(region->permission, isZeroInitialized(region->kind));
+        }
+
+        // Pages are committed on first touch and take their permissions from the regions covering them.
+        // hostData backs a fresh page with host memory instead of its own zeroed storage.
+        Page& commitPage(const u64 pageIndex, u8* hostData = nullptr) {
+            auto [it, inserted] = pages.try_emplace(pageIndex);
+            if (!inserted) {
+                return *it->second;
+            }
+            it->second = pool.allocate();
+            Page& page = *it->second;
+
+            const u64 pageStart = pageIndex * PageSize;
+            auto regionIt = regions.upper_bound(pageStart);
+            if (regionIt != regions.begin() && std::prev(regionIt)->second.contains(pageStart)) {
+                --regionIt;
+            }
+
+            // file regions are always page aligned, so they either back the whole page or nothing of it
+            const Region* fileRegion = regionIt != regions.end() && regionIt->second.kind == Region::Kind::File
+                && regionIt->second.contains(pageStart) ? &regionIt->second : nullptr;
+            if (fileRegion != nullptr && pageStart - fileRegion->start < fileRegion->backingSize) {
+                page.data = fileRegion->backing.get() + (pageStart - fileRegion->start);
+                page.initialized.set();
+                applyPermission(page, 0, PageSize, fileRegion->permission);
+                return page;
+            }
+
+            if (hostData != nullptr) {
+                page.data = hostData;
+            }
+            else {
+                PagePool::useStorage(page);
+            }
+            if (fileRegion != nullptr) {
+                // beyond the end of the file, any access is a bus error
+                return page;
+            }
+
+            for (; regionIt != regions.end(); ++regionIt) {
+                const Region& region = regionIt->second;
+                if (!region.contains(pageStart) && region.start - pageStart >= PageSize) {
+                    break;
+                }
+                const u64 first = std::max(region.start, pageStart);
+                const u64 count = std::min<u64>(region.start + region.length - first, PageSize - (first - pageStart));
+                applyPermission(page, first - pageStart, count, region.permission);
+
+                if (isZeroInitialized(region.kind)) {
+                    markInitialized(page, first - pageStart, count);
+                }
+            }
+            return page;
+        }
+
+        template <typename Function>
+        void forEachCommittedPage(const u64 address, const u64 size, Function function) {
+            const u64 firstPage = address / PageSize;
+            const u64 pageCount = (alignToPage(address + size) - address / PageSize * PageSize) / PageSize;
+            if (pageCount > pages.size()) {
+                for (auto& [pageIndex, page] : pages) {
+                    if (pageIndex - firstPage < pageCount) {
+                        function(pageIndex, *page);
+                    }
+                }
+                return;
+            }
+            for (u64 n = 0; n < pageCount; ++n) {
+                if (auto it = pages.find(firstPage + n); it != pages.end()) {
+                    function(it->first, *it->second);
+                }
+            }
+        }
+
+        void protectCommittedPages(const u64 address, const u64 size, const Permission permission) {
+            forEachCommittedPage(address, size, [&](const u64 pageIndex, Page& page) {
+                const u64 pageStart = pageIndex * PageSize;
+                const u64 first = std::max(address, pageStart);
+                const u64 count = std::min<u64>(address + size - first, PageSize - (first - pageStart));
+                applyPermission(page, first - pageStart, count, permission);
+            });
+        }
+
+        void releasePages(const u64 address, const u64 size) {
+            const u64 firstPage = address / PageSize;
+            const u64 pageCount = size / PageSize;
+            if (pageCount > pages.size()) {
+                std::erase_if(pages, [&](const auto& entry) {
+                    if (entry.first - firstPage < pageCount) {
+                        pool.release(entry.second);
+                        return true;
+                    }
+                    return false;
+                });
+            }
+            else {
+                for (u64 n = 0; n < pageCount; ++n) {
+                    if (auto it = pages.find(firstPage + n); it != pages.end()) {
+                        pool.release(it->second);
+                        pages.erase(it);
+                    }
+                }
+            }
+            lastPageIndex = UINT64_MAX;
+            lastPage = nullptr;
+            lastCodePageIndex = UINT64_MAX;
+            lastCodePage = nullptr;
+        }
+
+        // Splits the region containing address, so that a region starts exactly at address
+        void splitRegionAt(const u64 address) {
+            auto it = regions.upper_bound(address);
+            if (it == regions.begin()) {
+                return;
+            }
+            --it;
+            Region& region = it->second;
+            if (region.start == address || !region.contains(address)) {
+                return;
+            }
+            Region upper = region;
+            upper.start = address;
+            upper.length = region.start + region.length - address;
+            region.length = address - region.start;
+            if (upper.backing) {
+                upper.backing = std::shared_ptr<u8>(region.backing, region.backing.get() + region.length);
+                upper.backingSize = region.backingSize > region.length ? region.backingSize - region.length : 0;
+            }
+            regions.emplace(address, upper);
+        }
+
     public:
-        Page& getPage(const u64 address) {
+        Memory() {
+            mapRegion(StackBase, StackSize, Permission{ true, true, false }, Region::Kind::Stack);
+        }
+
+        ~Memory() {
+            for (auto& [pageIndex, page] : pages) {
+                pool.release(page);
+            }
+        }
+
+        Memory(const Memory&) = delete;
+        Memory& operator=(const Memory&) = delete;
+
+        const PagePool::Statistics& getPoolStatistics() const {
+            return pool.getStatistics();
+        }
+
+        const std::map<u64, Region>& getRegions() const {
+            return regions;
+        }
+
+        const Region* findRegion(const u64 address) const {
+            auto it = regions.upper_bound(address);
+            if (it == regions.begin()) {
+                return nullptr;
+            }
+            --it;
+            return it->second.contains(address) ? &it->second : nullptr;
+        }
+
+        bool isRangeFree(const u64 address, const u64 size) const {
+            if (findRegion(address) != nullptr) {
+                return false;
+            }
+            auto it = regions.upper_bound(address);
+            return it == regions.end() || it->first - address >= size;
+        }
+
+        // Top-down search for a free range below the stack, like mmap_base on Linux
+        u64 findFreeRange(const u64 size) const {
+            u64 ceiling = StackBase;
+            for (auto it = regions.rbegin(); it != regions.rend(); ++it) {
+                const Region& region = it->second;
+                if (region.start >= ceiling) {
+                    continue;
+                }
+                const u64 end = region.start + region.length;
+                if (end <= ceiling && ceiling - end >= size) {
+                    return ceiling - size;
+                }
+                ceiling = region.start;
+            }
+            if (ceiling >= size + PageSize) {
+                return ceiling - size;
+            }
+            return 0;
+        }
+
+        // Maps [address, address + size), replacing whatever was mapped there before
+        void mapRegion(const u64 address, const u64 size, const Permission permission, const Region::Kind kind) {
+            mapRegion(Region{ address, size, permission, kind });
+        }
+
+        void mapRegion(Region region) {
+            if (region.length == 0) {
+                return;
+            }
+            if (!isRangeFree(region.start, region.length)) {
+                unmapRegion(region.start, region.length);
+            }
+
+            // stale pages from accesses outside of any region must not leak into the new mapping,
+            // the linker however writes section data before mapping it
+            if (region.kind != Region::Kind::Section) {
+                releasePages(region.start, region.length);
+            }
+
+            auto next = regions.lower_bound(region.start);
+            Region* previous = next != regions.begin() ? &std::prev(next)->second : nullptr;
+            if (previous != nullptr && previous->start + previous->length == region.start && previous->kind == region.kind
+                && previous->permission == region.permission && region.kind != Region::Kind::File) {
+                previous->length += region.length;
+            }
+            else {
+                regions.emplace(region.start, std::move(region));
+            }
+        }
+
+        // Backs a page of linked sections with host memory instead of copying it. The regions covering the page
+        // have to be mapped already and the memory has to be handed to keepAlive.
+        void mapSectionPage(const u64 pageIndex, u8* data) {
+            if (pages.contains(pageIndex)) {
+                std::memcpy(commitPage(pageIndex).data, data, PageSize);
+                return;
+            }
+            commitPage(pageIndex, data);
+        }
+
+        void keepAlive(std::shared_ptr<u8> hostMemory) {
+            hostMappings.push_back(std::move(hostMemory));
+        }
+
+        const Page* findCommittedPage(const u64 pageIndex) const {
+            auto it = pages.find(pageIndex);
+            return it != pages.end() ? it->second : nullptr;
+        }
+
+        // Maps linked section bytes, pages the linker already wrote to get the permissions per byte
+        void mapSection(const u64 address, const u64 size, const Permission permission) {
+            mapRegion(address, size, permission, Region::Kind::Section);
+            forEachCommittedPage(address, size, [&](const u64 pageIndex, Page& page) {
+                const u64 pageStart = pageIndex * PageSize;
+                const u64 first = std::max(address, pageStart);
+                const u64 count = std::min<u64>(address + size - first, PageSize - (first - pageStart));
+                applyPermission(page, first - pageStart, count, permission);
+                markInitialized(page, first - pageStart, count);
+            });
+        }
+
+        void unmapRegion(const u64 address, const u64 size) {
+            splitRegionAt(address);
+            splitRegionAt(address + size);
+            for (auto it = regions.lower_bound(address); it != regions.end() && it->first - address < size;) {
+                it = regions.erase(it);
+            }
+
+            // pages shared with a neighbouring region stay committed, but lose access to the unmapped bytes
+            protectCommittedPages(address, size, Permission{});
+            const u64 headroom = alignToPage(address) - address;
+            if (size > headroom) {
+                releasePages(alignToPage(address), (size - headroom) / PageSize * PageSize);
+            }
+        }
+
+        // Returns false if part of the range is not mapped
+        bool protectRegion(const u64 address, const u64 size, const Permission permission) {
+            for (u64 current = address; current - address < size;) {
+                const Region* region = findRegion(current);
+                if (region == nullptr) {
+                    return false;
+                }
+                current = region->start + region->length;
+                if (current == 0) {
+                    break;
+                }
+            }
+
+            splitRegionAt(address);
+            splitRegionAt(address + size);
+            for (auto it = regions.lower_bound(address); it != regions.end() && it->first - address < size; ++it) {
+                it->second.permission = permission;
+            }
+            protectCommittedPages(address, size, permission);
+            return true;
+        }
+
+        // The heap starts at the first page after the highest linked section
+        void initProgramBreak() {
+            u64 sectionEnd = 0;
+            for (const auto& [start, region] : regions) {
+                if (region.kind == Region::Kind::Section) {
+                    sectionEnd = std::max(sectionEnd, region.start + region.length);
+                }
+            }
+            heapStart = alignToPage(sectionEnd);
+            programBreak = heapStart;
+        }
+
+        // Behaves like the Linux brk syscall: returns the new break, or the old one on failure
+        u64 setProgramBreak(const u64 requested) {
+            if (requested < heapStart || requested >= StackBase) {
+                return programBreak;
+            }
+
+            const u64 oldEnd = alignToPage(programBreak);
+            const u64 newEnd = alignToPage(requested);
+            if (newEnd > oldEnd) {
+                if (!isRangeFree(oldEnd, newEnd - oldEnd)) {
+                    return programBreak;
+                }
+                mapRegion(oldEnd, newEnd - oldEnd, Permission{ true, true, false }, Region::Kind::Heap);
+            }
+            else if (newEnd < oldEnd) {
+                unmapRegion(newEnd, oldEnd - newEnd);
+            }
+            programBreak = requested;
+            return programBreak;
+        }
+
+        // Pages are only materialized when they are written, reading untouched pages is served by a zero page
+        const Page& getPage(const u64 address) {
             const u64 pageIndex = address / PageSize;
             if (lastPageIndex == pageIndex) {
                 return *lastPage;
             }
 
-            auto [it, inserted] = pages.try_emplace(pageIndex);
-            if (inserted && address >= UINT64_MAX - 8_MiB) {
-                setPermission(pageIndex * PageSize, PageSize, Permission{ true, true, false });
+            if (auto it = pages.find(pageIndex); it != pages.end()) {
+                lastPageIndex = pageIndex;
+                lastPage = it->second;
+                return *it->second;
             }
+            if (const Page* page = findZeroPage(pageIndex)) {
+                return *page;
+            }
+            return getWritablePage(address);
+        }
+
+        Page& getWritablePage(const u64 address) {
+            const u64 pageIndex = address / PageSize;
+            if (lastPageIndex == pageIndex) {
+                return *lastPage;
+            }
+
+            Page& page = commitPage(pageIndex);
             lastPageIndex = pageIndex;
-            lastPage = &it->second;
-            return it->second;
+            lastPage = &page;
+            return page;
+        }
+
+        u64 getCommittedPageCount() const {
+            return pages.size();
+        }
+
+        // Committed pages with their own storage, file-backed pages live in the host page cache
+        u64 getResidentPageCount() const {
+            return std::ranges::count_if(pages, [](const auto& entry) {
+                return entry.second->data == entry.second->storage.data();
+            });
         }
 
         template <std::unsigned_integral T>
@@ -61,7 +617,7 @@ class Memory {
             u32 dataSize = sizeof(data);
 
             if (offset + dataSize <= PageSize) {
-                Page& page = getPage(address);
+                Page& page = getWritablePage(address);
                 for (u32 i = 0; i < dataSize; ++i) {
                     if (!page.permissionWrite.test(offset + i)) {
                         LOG_ERROR("Write access violation at address 0x{:016x}", address + i);
@@ -75,7 +631,7 @@ class Memory {
             // slow path
             for (u32 i = 0; i < dataSize / sizeof(u8); ++i) {
                 u32 offset = (address + i) % PageSize;
-                Page& page = getPage(address + i);
+                Page& page = getWritablePage(address + i);
 
                 if (!page.permissionWrite.test(offset)) {
                    LOG_ERROR("Write access violation at address 0x{:016x}", address + i);
@@ -92,7 +648,7 @@ class Memory {
             u32 dataSize = sizeof(data);
 
             if (offset + dataSize <= PageSize) {
-                Page& page = getPage(address);
+                Page& page = getWritablePage(address);
                 for (u32 i = 0; i < dataSize; ++i) {
                     page.data[offset + i] = data >> (8 * i) & 0xFF;
                     page.initialized.set(offset + i);
@@ -103,7 +659,7 @@ class Memory {
             // slow path
             for (u32 i = 0; i < dataSize / sizeof(u8); ++i) {
                 u32 offset = (address + i) % PageSize;
-                Page& page = getPage(address + i);
+                Page& page = getWritablePage(address + i);
                 page.data[offset] = data >> (8 * i) & 0xFF;
                 page.initialized.set(offset);
             }
@@ -116,7 +672,7 @@ class Memory {
             u32 dataSize = sizeof(data);
 
             if (offset + dataSize <= PageSize) {
-                Page& page = getPage(address);
+                const Page& page = getPage(address);
                 data = 0;
                 for (u32 i = 0; i < dataSize; ++i) {
                     if (!page.permissionRead.test(offset + i)) {
@@ -134,7 +690,7 @@ class Memory {
             data = 0;
             for (u32 i = 0; i < dataSize / sizeof(u8); ++i) {
                 offset = (address + i) % PageSize;
-                Page& page = getPage(address + i);
+                const Page& page = getPage(address + i);
                 if (!page.permissionRead.test(offset)) {
                    LOG_ERROR("Read access violation at address 0x{:016x}", address + i);
                 }
@@ -152,7 +708,7 @@ class Memory {
             u32 dataSize = sizeof(data);
 
             if (offset + dataSize <= PageSize) {
-                Page& page = getPage(address);
+                const Page& page = getPage(address);
                 data = 0;
                 for (u32 i = 0; i < dataSize; ++i) {
                     data |= static_cast<T>(page.data[offset + i]) << (8 * i);
@@ -164,37 +720,81 @@ class Memory {
             data = 0;
             for (u32 i = 0; i < dataSize / sizeof(u8); ++i) {
                 u32 offset = (address + i) % PageSize;
-                Page& page = getPage(address + i);
+                const Page& page = getPage(address + i);
                 data |= static_cast<T>(page.data[offset]) << (8 * i);
             }
         }
 
+        // Collects all bulk writes into the given list until it is reset to nullptr
+        void captureWrites(std::vector<CapturedWrite>* writes) {
+            capturedWrites = writes;
+        }
+
+        // Bulk transfers for syscalls, an inaccessible range is reported instead of being an access violation
+        bool isReadable(const u64 address, const u64 size) {
+            return address + size >= address && forEachChunk(address, size, [&](u64 current, u64 offset, u64 count, u64) {
+                return allSet(getPage(current).permissionRead, offset, count);
+            });
+        }
+
+        bool isWritable(const u64 address, const u64 size) {
+            return address + size >= address && forEachChunk(address, size, [&](u64 current, u64 offset, u64 count, u64) {
+                return allSet(getPage(current).permissionWrite, offset, count);
+            });
+        }
+
+        bool readBytes(const u64 address, u8* data, const u64 size) {
+            if (!isReadable(address, size)) {
+                return false;
+            }
+            return forEachChunk(address, size, [&](u64 current, u64 offset, u64 count, u64 done) {
+                std::memcpy(data + done, getPage(current).data + offset, count);
+                return true;
+            });
+        }
+
+        bool writeBytes(const u64 address, const u8* data, const u64 size) {
+            if (!isWritable(address, size)) {
+                return false;
+            }
+            if (capturedWrites != nullptr) {
+                capturedWrites->push_back(CapturedWrite{ address, std::vector<u8>(data, data + size) });
+            }
+            return forEachChunk(address, size, [&](u64 current, u64 offset, u64 count, u64 done) {
+                Page& page = getWritablePage(current);
+                std::memcpy(page.data + offset, data + done, count);
+                markInitialized(page, offset, count);
+                return true;
+            });
+        }
+
+        // Reads a NUL terminated string of at most maxLength bytes
+        bool readString(const u64 address, std::string& string, const u64 maxLength) {
+            string.clear();
+            bool terminated = false;
+            forEachChunk(address, maxLength, [&](u64 current, u64 offset, u64 count, u64) {
+                const Page& page = getPage(current);
+                const u8* begin = page.data + offset;
+                const u8* end = static_cast<const u8*>(std::memchr(begin, 0, count));
+                const u64 length = end != nullptr ? end - begin : count;
+                if (!allSet(page.permissionRead, offset, end != nullptr ? length + 1 : length)) {
+                    return false;
+                }
+                string.append(reinterpret_cast<const char*>(begin), length);
+                terminated = end != nullptr;
+                return !terminated;
+            });
+            return terminated;
+        }
+
         void setPermission(const u64 address, const u64 size, Permission permission) {
             u64 current = address;
             u64 remaining = size;
             while (remaining > 0) {
-                Page& page = pages[current / PageSize];
+                Page& page = commitPage(current / PageSize);
                 const u64 offset = current % PageSize;
                 const u64 count = std::min(remaining, PageSize - offset);
-                for (u64 n = 0; n < count; ++n) {
-                    if (permission.read) {
-                        page.permissionRead.set(offset + n);
-                    } else {
-                        page.permissionRead.reset(offset + n);
-                    }
-
-                    if (permission.write) {
-                        page.permissionWrite.set(offset + n);
-                    } else {
-                        page.permissionWrite.reset(offset + n);
-                    }
-
-                    if (permission.execute) {
-                        page.permissionExecute.set(offset + n);
-                    } else {
-                        page.permissionExecute.reset(offset + n);
-                    }
-                }
+                applyPermission(page, offset, count, permission);
                 current += count;
                 remaining -= count;
             }
@@ -202,7 +802,7 @@ class Memory {
 
         Permission getBytePermission(const u64 address) {
             u32 offset = address % PageSize;
-            Page& page = pages[address / PageSize];
+            const Page& page = getPage(address);
 
             Permission permission = {};
             permission.read = page.permissionRead.test(offset);
@@ -215,15 +815,17 @@ class Memory {
             const u32 offset = address % PageSize;
             const u64 pageIndex = address / PageSize;
 
-            Page* page;
+            const Page* page;
             if (lastCodePageIndex == pageIndex) {
                 page = lastCodePage;
             }
-            else {
-                auto [it, inserted] = pages.try_emplace(pageIndex);
-                page = &it->second;
+            else if (auto it = pages.find(pageIndex); it != pages.end()) {
+                page = it->second;
                 lastCodePageIndex = pageIndex;
-                lastCodePage = &it->second;
+                lastCodePage = it->second;
+            }
+            else {
+                page = &getPage(address);
             }
 
             if (!page->permissionExecute.test(offset)) {
@@ -3,12 +3,14 @@
 
 #pragma once
 
-#include <string>
-#include <unordered_map>
-#include <vector>
+#include <string_view>
+#include <variant>
 
+#include "inline_list.h"
+#include "perfect_hash.h"
 #include "types.h"
-#include "instructions.h"
+#include "global_state.h"
+#include "parser/ast.h"
 
 namespace Interpreter::Mnemonics
 {
@@ -39,107 +41,224 @@ struct OperandSpec {
         MemoryNoSize,
     };
     Type type;
-    std::vector<u8> sizes;
+    InlineList<u8, 4> sizes;
 };
 
-using InstructionForm = std::vector<OperandSpec>;
+using InstructionForm = InlineList<OperandSpec, 2>;
 using OpType = OperandSpec::Type;
 
-struct InstructionDetails {
-    InstructionSet instructionSet;
-    std::vector<std::string> allowedPrefixes;
-    std::vector<std::string> allowedSuffixes;
-    std::vector<InstructionForm> forms;
-    u32 (*implementation)(GlobalState&, Ast::Instruction&);
-};
-
-inline std::vector<std::string> integerSizeSuffixes = {
+inline constexpr InlineList<std::string_view, 4> integerSizeSuffixes = {
     "b", // byte
     "w", // word
     "l", // long
     "q", // quad
 };
+inline constexpr InlineList<std::string_view, 4> WordAndQuadSuffixes = { "w", "q" };
+inline constexpr InlineList<std::string_view, 4> QuadSuffix = { "q" };
+inline constexpr InlineList<std::string_view, 4> None = {};
 
-inline std::vector<u8> All { 8, 16, 32, 64 };
-inline std::vector<u8> WordAndUp { 16, 32, 64 };
+inline constexpr InlineList<u8, 4> All { 8, 16, 32, 64 };
+inline constexpr InlineList<u8, 4> WordAndUp { 16, 32, 64 };
 
-inline std::vector<InstructionForm> NormalForms {
+inline constexpr InlineList<InstructionForm, 3> NormalForms {
     {{ OpType::Register, All }, { OpType::RegisterOrMemory, All }},
     {{ OpType::Memory, All }, { OpType::Register, All }},
     {{ OpType::Immediate, All }, { OpType::RegisterOrMemory, All }},
 };
 
-inline std::vector<InstructionForm> NoMemoryForms {
+inline constexpr InlineList<InstructionForm, 3> NoMemoryForms {
     {{ OpType::Register, All }, { OpType::RegisterOrMemory, All }},
     {{ OpType::Immediate, All }, { OpType::RegisterOrMemory, All }},
 };
 
-inline std::vector<InstructionForm> SingleOpOnlyRMForms {
+inline constexpr InlineList<InstructionForm, 3> SingleOpOnlyRMForms {
     {{ OpType::RegisterOrMemory, All }},
 };
 
-inline std::vector<InstructionForm> NoOperandsForms {
+inline constexpr InlineList<InstructionForm, 3> NoOperandsForms {
     {}
 };
 
-inline std::unordered_map<std::string, InstructionDetails> instructionDefinitions = {
-    {"lea", {InstructionSet::x86_64, {}, integerSizeSuffixes, {
-        {{ OpType::MemoryNoSize, {} }, { OpType::Register, WordAndUp }},
-    }, Instructions::lea }},
-    {"mov", {InstructionSet::x86_64, {}, integerSizeSuffixes, NormalForms, Instructions::mov }},
-    {"xor", {InstructionSet::x86_64, {}, integerSizeSuffixes, NormalForms, Instructions::Xor }},
-    {"and", {InstructionSet::x86_64, {}, integerSizeSuffixes, NormalForms, Instructions::And }},
-    {"add", {InstructionSet::x86_64, {}, integerSizeSuffixes, NormalForms, Instructions::add }},
-    {"sub", {InstructionSet::x86_64, {}, integerSizeSuffixes, NormalForms, Instructions::sub }},
-    {"cmp", {InstructionSet::x86_64, {}, integerSizeSuffixes, NormalForms, Instructions::cmp }},
-    {"inc", {InstructionSet::x86_64, {}, integerSizeSuffixes, SingleOpOnlyRMForms, Instructions::inc }},
-    {"dec", {InstructionSet::x86_64, {}, integerSizeSuffixes, SingleOpOnlyRMForms, Instructions::dec }},
-    {"neg", {InstructionSet::x86_64, {}, integerSizeSuffixes, SingleOpOnlyRMForms, Instructions::neg }},
-    {"test", {InstructionSet::x86_64, {}, integerSizeSuffixes, NoMemoryForms, Instructions::test }},
-    {"push", {InstructionSet::x86_64, {}, {"w", "q"}, {
-        {{ OpType::RegisterOrMemory, {16, 64} }},
-        {{ OpType::Immediate, {8, 16, 32} }},
-    }, Instructions::push }},
-    {"pop", {InstructionSet::x86_64, {}, {"w", "q"}, {
-            {{ OpType::RegisterOrMemory, {16, 64} }},
-    }, Instructions::pop }},
-    {"call", {InstructionSet::x86_64, {}, {"q"}, {
-        {{ OpType::Relative, {32} }},
-            {{ OpType::RegisterOrMemory, {64} }},
-    }, Instructions::call }},
-    {"ret", {InstructionSet::x86_64, {}, {"q"}, {
-        {},
-        {{ OpType::Immediate, {16} }},
-    }, Instructions::ret }},
-    {"jmp", {InstructionSet::x86_64, {}, {"q"}, {
-        {{ OpType::Relative, {8, 32} }},
-        {{ OpType::RegisterOrMemory, {64} }},
-    }, Instructions::jmp }},
-    {"Jcc", {InstructionSet::x86_64, {}, {"q"}, {
-        {{ OpType::Relative, {8, 32} }},
-    }, Instructions::Jcc }},
-    {"CMOVcc", {InstructionSet::x86_64, {}, integerSizeSuffixes, {
-        {{ OpType::RegisterOrMemory, WordAndUp }, { OpType::Register, WordAndUp }},
-    }, Instructions::CMOVcc }},
-    {"stc", {InstructionSet::x86_64, {}, {}, NoOperandsForms, Instructions::stc }},
-    {"hlt", {InstructionSet::x86_64, {}, {}, NoOperandsForms, Instructions::hlt }},
-    {"leave", {InstructionSet::x86_64, {}, {}, NoOperandsForms, Instructions::leave }},
-    {"syscall", {InstructionSet::x86_64, {}, {}, NoOperandsForms, Instructions::syscall }},
-    {"checkpoint", {InstructionSet::custom, {}, {}, {
-        {{ OpType::Immediate, {64} }},
-    }, Instructions::checkpoint }},
-};
-
-inline std::vector<std::string> populatePossiblePrefixes() {
-    std::vector<std::string> possiblePrefixes = {};
-    for (const auto& [mnemonicName, details] : instructionDefinitions) {
-        for (const auto& prefix : details.allowedPrefixes) {
-            if (std::ranges::find(possiblePrefixes, prefix) == possiblePrefixes.end()) {
-                possiblePrefixes.push_back(prefix);
+inline constexpr InlineList<InstructionForm, 3> LeaForms {
+    {{ OpType::MemoryNoSize, {} }, { OpType::Register, WordAndUp }},
+};
+
+inline constexpr InlineList<InstructionForm, 3> PushForms {
+    {{ OpType::RegisterOrMemory, {16, 64} }},
+    {{ OpType::Immediate, {8, 16, 32} }},
+};
+
+inline constexpr InlineList<InstructionForm, 3> PopForms {
+    {{ OpType::RegisterOrMemory, {16, 64} }},
+};
+
+inline constexpr InlineList<InstructionForm, 3> CallForms {
+    {{ OpType::Relative, {32} }},
+    {{ OpType::RegisterOrMemory, {64} }},
+};
+
+inline constexpr InlineList<InstructionForm, 3> RetForms {
+    {},
+    {{ OpType::Immediate, {16} }},
+};
+
+inline constexpr InlineList<InstructionForm, 3> JmpForms {
+    {{ OpType::Relative, {8, 32} }},
+    {{ OpType::RegisterOrMemory, {64} }},
+};
+
+inline constexpr InlineList<InstructionForm, 3> JccForms {
+    {{ OpType::Relative, {8, 32} }},
+};
+
+inline constexpr InlineList<InstructionForm, 3> CMOVccForms {
+    {{ OpType::RegisterOrMemory, WordAndUp }, { OpType::Register, WordAndUp }},
+};
+
+inline constexpr InlineList<InstructionForm, 3> CheckpointForms {
+    {{ OpType::Immediate, {64} }},
+};
+
+// The instruction set in one place: mnemonic, handler, instruction set, prefixes, suffixes and operand forms.
+// The handler declarations, the mnemonic table and the form masks the parser checks are generated from it,
+// adding an instruction is a line here and the definition of its handler in instructions.cpp.
+// Jcc and CMOVcc stand for every condition code, the parser maps names like 'jne' or 'cmovge' to them.
+#define ASMCUBE_INSTRUCTIONS(X) \
+    X("lea", lea, x86_64, None, integerSizeSuffixes, LeaForms) \
+    X("mov", mov, x86_64, None, integerSizeSuffixes, NormalForms) \
+    X("xor", Xor, x86_64, None, integerSizeSuffixes, NormalForms) \
+    X("and", And, x86_64, None, integerSizeSuffixes, NormalForms) \
+    X("add", add, x86_64, None, integerSizeSuffixes, NormalForms) \
+    X("sub", sub, x86_64, None, integerSizeSuffixes, NormalForms) \
+    X("cmp", cmp, x86_64, None, integerSizeSuffixes, NormalForms) \
+    X("inc", inc, x86_64, None, integerSizeSuffixes, SingleOpOnlyRMForms) \
+    X("dec", dec, x86_64, None, integerSizeSuffixes, SingleOpOnlyRMForms) \
+    X("neg", neg, x86_64, None, integerSizeSuffixes, SingleOpOnlyRMForms) \
+    X("test", test, x86_64, None, integerSizeSuffixes, NoMemoryForms) \
+    X("push", push, x86_64, None, WordAndQuadSuffixes, PushForms) \
+    X("pop", pop, x86_64, None, WordAndQuadSuffixes, PopForms) \
+    X("call", call, x86_64, None, QuadSuffix, CallForms) \
+    X("ret", ret, x86_64, None, QuadSuffix, RetForms) \
+    X("jmp", jmp, x86_64, None, QuadSuffix, JmpForms) \
+    X("Jcc", Jcc, x86_64, None, QuadSuffix, JccForms) \
+    X("CMOVcc", CMOVcc, x86_64, None, integerSizeSuffixes, CMOVccForms) \
+    X("stc", stc, x86_64, None, None, NoOperandsForms) \
+    X("hlt", hlt, x86_64, None, None, NoOperandsForms) \
+    X("leave", leave, x86_64, None, None, NoOperandsForms) \
+    X("syscall", syscall, x86_64, None, None, NoOperandsForms) \
+    X("checkpoint", checkpoint, custom, None, None, CheckpointForms)
+
+} // namespace Interpreter::Mnemonics
+
+namespace Interpreter::Instructions
+{
+
+#define ASMCUBE_DECLARE_HANDLER(mnemonic, handler, ...) u32 handler(GlobalState& globalState, Ast::Instruction& instruction);
+ASMCUBE_INSTRUCTIONS(ASMCUBE_DECLARE_HANDLER)
+#undef ASMCUBE_DECLARE_HANDLER
+
+} // namespace Interpreter::Instructions
+
+namespace Interpreter::Mnemonics
+{
+
+static_assert(std::is_same_v<std::variant_alternative_t<static_cast<u32>(Ast::OperandType::Symbol), Ast::Operand>, Ast::Symbol>,
+              "Ast::OperandType has to follow the alternatives of Ast::Operand");
+
+constexpr u32 operandKindBit(const Ast::OperandType type) {
+    return 1u << static_cast<u32>(type);
+}
+
+// The kinds of AST operands a spec accepts as bits, symbols are accepted wherever an immediate or label is
+constexpr u32 acceptedOperandKinds(const OpType type) {
+    switch (type) {
+        case OpType::Register:
+            return operandKindBit(Ast::OperandType::Register);
+        case OpType::Memory:
+        case OpType::MemoryNoSize:
+            return operandKindBit(Ast::OperandType::Memory);
+        case OpType::RegisterOrMemory:
+            return operandKindBit(Ast::OperandType::Register) | operandKindBit(Ast::OperandType::Memory);
+        case OpType::Immediate:
+            return operandKindBit(Ast::OperandType::Immediate) | operandKindBit(Ast::OperandType::Symbol);
+        case OpType::Relative:
+            return operandKindBit(Ast::OperandType::RelativeImmediate) | operandKindBit(Ast::OperandType::Symbol);
+    }
+    return 0;
+}
+
+// The low byte has a bit for the operand count, each following byte the kinds one operand may have.
+// Operands fit a form if their signature has no bit that the mask of the form lacks.
+constexpr u32 formMask(const InstructionForm& form) {
+    u32 mask = 1u << form.size();
+    for (u32 i = 0; i < form.size(); ++i) {
+        mask |= acceptedOperandKinds(form[i].type) << (8 * (i + 1));
+    }
+    return mask;
+}
+
+constexpr InlineList<u32, 3> formMasks(const InlineList<InstructionForm, 3>& forms) {
+    InlineList<u32, 3> masks;
+    for (const InstructionForm& form : forms) {
+        masks.push_back(formMask(form));
+    }
+    return masks;
+}
+
+inline u32 operandSignature(const Ast::Operands& operands) {
+    u32 signature = 1u << operands.size();
+    for (u32 i = 0; i < operands.size(); ++i) {
+        signature |= (1u << operands[i].index()) << (8 * (i + 1));
+    }
+    return signature;
+}
+
+struct InstructionDetails {
+    InstructionSet instructionSet;
+    InlineList<std::string_view, 4> allowedPrefixes;
+    InlineList<std::string_view, 4> allowedSuffixes;
+    InlineList<InstructionForm, 3> forms;
+    // one per form, built with the table
+    InlineList<u32, 3> formMasks;
+    u32 (*implementation)(GlobalState&, Ast::Instruction&);
+
+    // The first form the operands fit, nullptr if there is none
+    const InstructionForm* findForm(const Ast::Operands& operands) const {
+        const u32 signature = operandSignature(operands);
+        for (u32 i = 0; i < forms.size(); ++i) {
+            if ((signature & ~formMasks[i]) == 0) {
+                return &forms[i];
             }
         }
+        return nullptr;
     }
-    return possiblePrefixes;
-}
+};
+
+#define ASMCUBE_DEFINE_INSTRUCTION(mnemonic, handler, set, prefixes, suffixes, instructionForms) \
+    {mnemonic, {InstructionSet::set, prefixes, suffixes, instructionForms, formMasks(instructionForms), Instructions::handler}},
+inline constexpr auto instructionDefinitions = makePerfectHashTable<InstructionDetails>({
+    ASMCUBE_INSTRUCTIONS(ASMCUBE_DEFINE_INSTRUCTION)
+});
+#undef ASMCUBE_DEFINE_INSTRUCTION
+
+// Every prefix the assembler knows, whether an instruction accepts it is up to allowedPrefixes
+inline constexpr auto instructionPrefixes = makePerfectHashTable<bool>({
+    {"lock", true},
+    {"rep", true},
+    {"repe", true},
+    {"repz", true},
+    {"repne", true},
+    {"repnz", true},
+});
+
+static_assert([] {
+    bool known = true;
+    instructionDefinitions.forEach([&](std::string_view, const InstructionDetails& details) {
+        for (const std::string_view prefix : details.allowedPrefixes) {
+            known = known && instructionPrefixes.contains(prefix);
+        }
+    });
+    return known;
+}(), "every allowed prefix has to be in instructionPrefixes");
 
-} // namespace Interpreter::Mnemonics
\ No newline at end of file
+} // namespace Interpreter::Mnemonics
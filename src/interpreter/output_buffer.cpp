@@ -0,0 +1,140 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <sys/stat.h>
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+#endif
+
+#include "output_buffer.h"
+
+namespace Interpreter
+{
+
+namespace {
+
+bool isValidDescriptor(const s32 fd) {
+#ifdef _WIN32
+    return _get_osfhandle(fd) != -1;
+#else
+    return fcntl(fd, F_GETFD) != -1;
+#endif
+}
+
+bool isInteractive(const s32 fd) {
+#ifdef _WIN32
+    if (_isatty(fd)) {
+        return true;
+    }
+    struct _stat64 fileStat {};
+    return _fstat64(fd, &fileStat) == 0 && (fileStat.st_mode & _S_IFIFO) != 0;
+#else
+    if (isatty(fd)) {
+        return true;
+    }
+    struct stat fileStat {};
+    return fstat(fd, &fileStat) == 0 && S_ISFIFO(fileStat.st_mode);
+#endif
+}
+
+} // namespace
+
+OutputBuffer::~OutputBuffer() {
+    flushAll();
+}
+
+s64 OutputBuffer::append(const s32 fd, const u8* data, const u64 size) {
+    Statistics& fileStatistics = statistics[fd];
+    ++fileStatistics.guestWrites;
+
+    if (!enabled || size == 0) {
+        return writeToHost(fd, data, size);
+    }
+
+    auto it = buffers.find(fd);
+    if (it == buffers.end()) {
+        // the descriptor is checked once when its buffer is created, invalid ones are not buffered,
+        // so the guest still gets its error right away. Later host errors show up when flushing.
+        if (!isValidDescriptor(fd)) {
+            return writeToHost(fd, data, size);
+        }
+        it = buffers.emplace(fd, std::vector<u8>{}).first;
+        it->second.reserve(Capacity);
+    }
+    std::vector<u8>& buffer = it->second;
+    if (buffer.size() + size > Capacity) {
+        if (const s64 result = flush(fd); result < 0) {
+            return result;
+        }
+    }
+    if (size >= Capacity) {
+        return writeToHost(fd, data, size);
+    }
+    buffer.insert(buffer.end(), data, data + size);
+    return static_cast<s64>(size);
+}
+
+s64 OutputBuffer::flush(const s32 fd) {
+    auto it = buffers.find(fd);
+    if (it == buffers.end() || it->second.empty()) {
+        return 0;
+    }
+    std::vector<u8>& buffer = it->second;
+    u64 offset = 0;
+    while (offset < buffer.size()) {
+        const s64 written = writeToHost(fd, buffer.data() + offset, buffer.size() - offset);
+        if (written <= 0) {
+            buffer.clear();
+            return written;
+        }
+        offset += written;
+    }
+    buffer.clear();
+    return static_cast<s64>(offset);
+}
+
+void OutputBuffer::flushAll() {
+    for (auto& [fd, buffer] : buffers) {
+        flush(fd);
+    }
+}
+
+void OutputBuffer::release(const s32 fd) {
+    flush(fd);
+    buffers.erase(fd);
+}
+
+void OutputBuffer::flushBeforeRead(const s32 fd) {
+    if (enabled && isInteractive(fd)) {
+        flushAll();
+    }
+}
+
+void OutputBuffer::countDirectWrite(const s32 fd, const s64 written) {
+    Statistics& fileStatistics = statistics[fd];
+    ++fileStatistics.guestWrites;
+    ++fileStatistics.hostWrites;
+    if (written > 0) {
+        fileStatistics.bytesWritten += written;
+    }
+}
+
+s64 OutputBuffer::writeToHost(const s32 fd, const u8* data, const u64 size) {
+    Statistics& fileStatistics = statistics[fd];
+    ++fileStatistics.hostWrites;
+#ifdef _WIN32
+    const s64 written = _write(fd, data, static_cast<u32>(size));
+#else
+    const s64 written = ::write(fd, data, size);
+#endif
+    if (written > 0) {
+        fileStatistics.bytesWritten += written;
+    }
+    return written;
+}
+
+} // namespace Interpreter
@@ -0,0 +1,63 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "types.h"
+
+namespace Interpreter
+{
+
+// Write-combining layer for guest output, small writes are collected per fd and handed to the host in large batches
+class OutputBuffer {
+    public:
+        static constexpr u64 Capacity = 64_KiB;
+
+        struct Statistics {
+            u64 guestWrites = 0;
+            u64 hostWrites = 0;
+            u64 bytesWritten = 0;
+        };
+
+        OutputBuffer() = default;
+        ~OutputBuffer();
+
+        OutputBuffer(const OutputBuffer&) = delete;
+        OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+        void setEnabled(const bool value) {
+            enabled = value;
+        }
+
+        bool isEnabled() const {
+            return enabled;
+        }
+
+        // Falls back to a direct host write when disabled, errors of buffered writes only show up when flushing
+        s64 append(s32 fd, const u8* data, u64 size);
+        s64 flush(s32 fd);
+        void flushAll();
+        // Flushes and drops the buffer of a descriptor that is being closed or replaced,
+        // the next write to the number validates the new descriptor
+        void release(s32 fd);
+        // Pending output has to reach the host before the guest waits for input from a terminal or pipe
+        void flushBeforeRead(s32 fd);
+        // Counts a write the guest handed to the host without this buffer, like an asynchronous one
+        void countDirectWrite(s32 fd, s64 written);
+
+        const std::map<s32, Statistics>& getStatistics() const {
+            return statistics;
+        }
+
+    private:
+        bool enabled = false;
+        std::map<s32, std::vector<u8>> buffers;
+        std::map<s32, Statistics> statistics;
+
+        s64 writeToHost(s32 fd, const u8* data, u64 size);
+};
+
+} // namespace Interpreter
@@ -0,0 +1,403 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+#ifdef WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <windows_stuff.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <magic_enum/magic_enum.hpp>
+
+#include "logging.h"
+#include "mnemonics.h"
+#include "parser/parser.h"
+#include "program_image.h"
+
+namespace Interpreter::ProgramImage
+{
+
+namespace {
+
+constexpr char Magic[8] = { 'A', 'C', 'I', 'M', 'A', 'G', 'E', '\0' };
+
+// NUL terminated names, each stored once
+class StringTable {
+    public:
+        u32 add(const std::string_view text) {
+            if (auto it = offsets.find(std::string(text)); it != offsets.end()) {
+                return it->second;
+            }
+            const u32 offset = static_cast<u32>(data.size());
+            data.append(text);
+            data.push_back('\0');
+            offsets.emplace(std::string(text), offset);
+            return offset;
+        }
+
+        const std::string& getData() const {
+            return data;
+        }
+
+    private:
+        std::string data;
+        std::unordered_map<std::string, u32> offsets;
+};
+
+void encodeRegister(const Ast::Register& reg, u8& width, u8& index) {
+    width = static_cast<u8>(reg.width);
+    index = reg.index;
+}
+
+Ast::Register decodeRegister(const u8 width, const u8 index) {
+    if (!Parser::isRegister(width, index)) {
+        LOG_ERROR("Invalid register {}/{} in program image", width, index);
+    }
+    return Ast::Register{ static_cast<Ast::Width>(width), index };
+}
+
+ImageOperand encodeOperand(const Ast::Operand& operand) {
+    ImageOperand record{};
+    record.type = static_cast<u8>(operand.index());
+    switch (static_cast<Ast::OperandType>(operand.index())) {
+        case Ast::OperandType::Register:
+            encodeRegister(std::get<Ast::Register>(operand), record.registerWidth, record.registerIndex);
+            break;
+
+        case Ast::OperandType::Immediate:
+            record.value = std::get<Ast::Immediate>(operand).value;
+            break;
+
+        case Ast::OperandType::RelativeImmediate:
+            {
+                const auto& target = std::get<Ast::RelativeImmediate>(operand).target;
+                if (!std::holds_alternative<s64>(target)) {
+                    LOG_ERROR("Unresolved relative immediate cannot be written to a program image");
+                }
+                record.value = static_cast<u64>(std::get<s64>(target));
+                break;
+            }
+
+        case Ast::OperandType::Memory:
+            {
+                const auto& memory = std::get<Ast::Memory>(operand);
+                if (memory.base.has_value()) {
+                    encodeRegister(*memory.base, record.baseWidth, record.baseIndex);
+                }
+                if (memory.index.has_value()) {
+                    encodeRegister(*memory.index, record.indexWidth, record.indexIndex);
+                }
+                if (memory.scale.has_value()) {
+                    record.scale = static_cast<u8>(*memory.scale) + 1;
+                }
+                if (memory.disp.has_value()) {
+                    if (!std::holds_alternative<s64>(*memory.disp)) {
+                        LOG_ERROR("Unresolved displacement cannot be written to a program image");
+                    }
+                    record.hasDisplacement = 1;
+                    record.value = static_cast<u64>(std::get<s64>(*memory.disp));
+                }
+                break;
+            }
+
+        case Ast::OperandType::Symbol:
+            LOG_ERROR("Unresolved symbol cannot be written to a program image");
+    }
+    return record;
+}
+
+Ast::Operand decodeOperand(const ImageOperand& record) {
+    switch (static_cast<Ast::OperandType>(record.type)) {
+        case Ast::OperandType::Register:
+            return decodeRegister(record.registerWidth, record.registerIndex);
+
+        case Ast::OperandType::Immediate:
+            return Ast::Immediate{ record.value };
+
+        case Ast::OperandType::RelativeImmediate:
+            return Ast::RelativeImmediate{ static_cast<s64>(record.value) };
+
+        case Ast::OperandType::Memory:
+            {
+                Ast::Memory memory;
+                if (record.baseWidth != 0) {
+                    memory.base = decodeRegister(record.baseWidth, record.baseIndex);
+                }
+                if (record.indexWidth != 0) {
+                    memory.index = decodeRegister(record.indexWidth, record.indexIndex);
+                }
+                if (record.scale != 0) {
+                    if (!magic_enum::enum_contains<Ast::Scale>(record.scale - 1)) {
+                        LOG_ERROR("Invalid scale {} in program image", record.scale);
+                    }
+                    memory.scale = static_cast<Ast::Scale>(record.scale - 1);
+                }
+                if (record.hasDisplacement != 0) {
+                    memory.disp = static_cast<s64>(record.value);
+                }
+                return memory;
+            }
+
+        default:
+            LOG_ERROR("Invalid operand type {} in program image", record.type);
+    }
+}
+
+// Views a string of the table, the table ends with a NUL so every offset inside it is terminated
+std::string_view getString(const char* strings, const u64 stringsSize, const u32 offset) {
+    if (offset >= stringsSize) {
+        LOG_ERROR("String offset {} is outside of the string table of the program image", offset);
+    }
+    return strings + offset;
+}
+
+template <typename T>
+void put(std::FILE* file, const T& value) {
+    std::fwrite(&value, sizeof(T), 1, file);
+}
+
+} // namespace
+
+bool isImage(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(Magic)] = {};
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, Magic, sizeof(Magic)) == 0;
+}
+
+bool write(const std::filesystem::path& path, GlobalState& globalState, const LinkedProgram& program) {
+    const Memory& memory = globalState.memory;
+    StringTable strings;
+
+    std::vector<ImageRegion> regions;
+    std::vector<u64> pageIndices;
+    for (const auto& [start, region] : memory.getRegions()) {
+        if (region.kind != Region::Kind::Section) {
+            continue;
+        }
+        regions.push_back(ImageRegion{ region.start, region.length, region.permission.read, region.permission.write, region.permission.execute, {} });
+        // neighbouring sections can share a page, regions are sorted so it is always the last one written
+        for (u64 pageIndex = region.start / PageSize; pageIndex * PageSize < region.start + region.length; ++pageIndex) {
+            if (memory.findCommittedPage(pageIndex) != nullptr && (pageIndices.empty() || pageIndices.back() != pageIndex)) {
+                pageIndices.push_back(pageIndex);
+            }
+        }
+    }
+
+    std::vector<ImageSymbol> symbols;
+    const SymbolTable& symbolTable = globalState.symbolTable;
+    for (SymbolTable::Id id = 0; id < symbolTable.size(); ++id) {
+        const Symbol& symbol = symbolTable.get(id);
+        if (symbol.kind != Symbol::Kind::Undefined) {
+            symbols.push_back(ImageSymbol{ strings.add(symbolTable.getName(id)), static_cast<u32>(symbol.kind), symbol.address, symbol.size });
+        }
+    }
+
+    std::vector<ImageInstruction> instructions;
+    instructions.reserve(program.instructions.size());
+    for (const LinkedInstruction& linkedInstruction : program.instructions) {
+        const Ast::Instruction& instruction = linkedInstruction.instruction;
+        ImageInstruction record{};
+        record.mnemonic = strings.add(instruction.mnemonic.mnemonicName);
+        record.prefix = instruction.mnemonic.prefix.empty() ? NoString : strings.add(instruction.mnemonic.prefix);
+        record.address = linkedInstruction.address;
+        record.width = instruction.mnemonic.width.has_value() ? static_cast<u8>(*instruction.mnemonic.width) : 0;
+        // only lowered for instructions with operands
+        record.operandWidth = instruction.operands.empty() ? 0 : static_cast<u8>(instruction.operandWidth);
+        if (instruction.additionalData.has_value()) {
+            record.condCode = static_cast<u8>(std::get<Ast::CondCode>(*instruction.additionalData)) + 1;
+        }
+        record.operandCount = static_cast<u8>(instruction.operands.size());
+        for (u32 i = 0; i < instruction.operands.size(); ++i) {
+            record.operands[i] = encodeOperand(instruction.operands[i]);
+        }
+        instructions.push_back(record);
+    }
+
+    ImageHeader header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = FileVersion;
+    header.regionCount = static_cast<u32>(regions.size());
+    header.entryPoint = program.entryPoint;
+    header.symbolCount = symbols.size();
+    header.instructionCount = instructions.size();
+    header.pageCount = pageIndices.size();
+    header.stringsSize = strings.getData().size();
+    const u64 stringsOffset = sizeof(ImageHeader) + regions.size() * sizeof(ImageRegion) + symbols.size() * sizeof(ImageSymbol)
+        + instructions.size() * sizeof(ImageInstruction) + pageIndices.size() * sizeof(u64);
+    header.pagesOffset = alignToPage(stringsOffset + header.stringsSize);
+
+    std::FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    put(file, header);
+    std::fwrite(regions.data(), sizeof(ImageRegion), regions.size(), file);
+    std::fwrite(symbols.data(), sizeof(ImageSymbol), symbols.size(), file);
+    std::fwrite(instructions.data(), sizeof(ImageInstruction), instructions.size(), file);
+    std::fwrite(pageIndices.data(), sizeof(u64), pageIndices.size(), file);
+    std::fwrite(strings.getData().data(), 1, strings.getData().size(), file);
+    const std::vector<u8> padding(header.pagesOffset - stringsOffset - header.stringsSize, 0);
+    std::fwrite(padding.data(), 1, padding.size(), file);
+    for (const u64 pageIndex : pageIndices) {
+        std::fwrite(memory.findCommittedPage(pageIndex)->data, 1, PageSize, file);
+    }
+    const bool success = std::ferror(file) == 0;
+    return std::fclose(file) == 0 && success;
+}
+
+LinkedProgram load(const std::filesystem::path& path, GlobalState& globalState) {
+    std::error_code error;
+    const u64 size = std::filesystem::file_size(path, error);
+    if (error || size < sizeof(ImageHeader)) {
+        LOG_ERROR("'{}' is not a program image", path.string());
+    }
+
+    // private and writable, guest writes to section pages stay in copy-on-write pages of this process
+    std::shared_ptr<u8> mapping;
+#ifdef WIN32
+    const s32 fd = _wopen(path.c_str(), _O_RDONLY | _O_BINARY);
+    void* view = nullptr;
+    u8* data = fd >= 0 ? Win_MapFile(fd, 0, size, false, true, view) : nullptr;
+    if (fd >= 0) {
+        _close(fd);
+    }
+    if (data != nullptr) {
+        mapping = std::shared_ptr<u8>(data, [view](u8*) { Win_UnmapFile(view); });
+    }
+#else
+    const s32 fd = ::open(path.c_str(), O_RDONLY);
+    void* data = fd >= 0 ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (data != MAP_FAILED) {
+        mapping = std::shared_ptr<u8>(static_cast<u8*>(data), [size](u8* pointer) { ::munmap(pointer, size); });
+    }
+#endif
+    if (mapping == nullptr) {
+        LOG_ERROR("Failed to map the program image '{}'", path.string());
+    }
+
+    u8* const base = mapping.get();
+    const ImageHeader& header = *reinterpret_cast<const ImageHeader*>(base);
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+        LOG_ERROR("'{}' is not a program image", path.string());
+    }
+    if (header.version != FileVersion) {
+        LOG_ERROR("Program image has version {}, expected {}", header.version, FileVersion);
+    }
+
+    // every count comes from the file, the tables are only located once they are known to fit
+    u64 offset = sizeof(ImageHeader);
+    const auto locate = [&](const u64 count, const u64 recordSize) {
+        if (count > (size - offset) / recordSize) {
+            LOG_ERROR("Program image '{}' is truncated", path.string());
+        }
+        const u8* table = base + offset;
+        offset += count * recordSize;
+        return table;
+    };
+    const auto* regions = reinterpret_cast<const ImageRegion*>(locate(header.regionCount, sizeof(ImageRegion)));
+    const auto* symbols = reinterpret_cast<const ImageSymbol*>(locate(header.symbolCount, sizeof(ImageSymbol)));
+    const auto* instructions = reinterpret_cast<const ImageInstruction*>(locate(header.instructionCount, sizeof(ImageInstruction)));
+    const auto* pageIndices = reinterpret_cast<const u64*>(locate(header.pageCount, sizeof(u64)));
+    const char* strings = reinterpret_cast<const char*>(locate(header.stringsSize, 1));
+    if (header.pagesOffset < offset || header.pagesOffset > size || header.pagesOffset % PageSize != 0
+        || header.pageCount > (size - header.pagesOffset) / PageSize) {
+        LOG_ERROR("Program image '{}' is truncated", path.string());
+    }
+    if (header.stringsSize != 0 && strings[header.stringsSize - 1] != '\0') {
+        LOG_ERROR("String table of program image '{}' is not terminated", path.string());
+    }
+
+    Memory& memory = globalState.memory;
+    for (u32 i = 0; i < header.regionCount; ++i) {
+        const ImageRegion& region = regions[i];
+        if (region.length == 0 || region.start % PageSize != 0 || region.length > StackBase - StackSize || region.start > StackBase - StackSize - region.length) {
+            LOG_ERROR("Invalid region 0x{:x} of length 0x{:x} in program image '{}'", region.start, region.length, path.string());
+        }
+        memory.mapRegion(region.start, region.length, Permission{ region.read != 0, region.write != 0, region.execute != 0 }, Region::Kind::Section);
+    }
+    for (u64 i = 0; i < header.pageCount; ++i) {
+        const bool mapped = std::any_of(regions, regions + header.regionCount, [pageIndex = pageIndices[i]](const ImageRegion& region) {
+            return pageIndex >= region.start / PageSize && pageIndex < alignToPage(region.start + region.length) / PageSize;
+        });
+        if (!mapped) {
+            LOG_ERROR("Page 0x{:x} of program image '{}' is outside of its regions", pageIndices[i], path.string());
+        }
+        memory.mapSectionPage(pageIndices[i], base + header.pagesOffset + i * PageSize);
+    }
+    memory.keepAlive(mapping);
+    memory.initProgramBreak();
+
+    globalState.symbolTable.reserve(static_cast<u32>(globalState.symbolTable.size() + header.symbolCount));
+    for (u64 i = 0; i < header.symbolCount; ++i) {
+        const auto kind = static_cast<Symbol::Kind>(symbols[i].kind);
+        if (kind != Symbol::Kind::Address && kind != Symbol::Kind::Immediate) {
+            LOG_ERROR("Invalid symbol kind {} in program image '{}'", symbols[i].kind, path.string());
+        }
+        globalState.symbolTable.insert(getString(strings, header.stringsSize, symbols[i].name), Symbol{ symbols[i].address, symbols[i].size, kind });
+    }
+
+    LinkedProgram program{ {}, header.entryPoint };
+    program.instructions.reserve(header.instructionCount);
+    for (u64 i = 0; i < header.instructionCount; ++i) {
+        const ImageInstruction& record = instructions[i];
+        const std::string_view name = getString(strings, header.stringsSize, record.mnemonic);
+        const Mnemonics::InstructionDetails* details = Mnemonics::instructionDefinitions.find(name);
+        if (details == nullptr) {
+            LOG_ERROR("Unknown mnemonic '{}' in program image", name);
+        }
+        if (record.operandCount > std::size(record.operands)) {
+            LOG_ERROR("Instruction '{}' has {} operands in program image", name, record.operandCount);
+        }
+
+        Ast::Instruction instruction{};
+        instruction.mnemonic.mnemonicName = Mnemonics::instructionDefinitions.findKey(name);
+        if (record.prefix != NoString) {
+            const std::string_view prefix = getString(strings, header.stringsSize, record.prefix);
+            if (!Mnemonics::instructionPrefixes.contains(prefix)) {
+                LOG_ERROR("Unknown prefix '{}' in program image", prefix);
+            }
+            instruction.mnemonic.prefix = Mnemonics::instructionPrefixes.findKey(prefix);
+        }
+        if (record.width != 0) {
+            if (!magic_enum::enum_contains<Ast::Width>(record.width)) {
+                LOG_ERROR("Invalid width {} in program image", record.width);
+            }
+            instruction.mnemonic.width = static_cast<Ast::Width>(record.width);
+        }
+        if (record.operandCount != 0) {
+            if (!magic_enum::enum_contains<Ast::Width>(record.operandWidth)) {
+                LOG_ERROR("Invalid operand width {} in program image", record.operandWidth);
+            }
+            instruction.operandWidth = static_cast<Ast::Width>(record.operandWidth);
+        }
+        if (record.condCode != 0) {
+            if (!magic_enum::enum_contains<Ast::CondCode>(record.condCode - 1)) {
+                LOG_ERROR("Invalid condition code {} in program image", record.condCode);
+            }
+            instruction.additionalData = static_cast<Ast::CondCode>(record.condCode - 1);
+        }
+        for (u32 n = 0; n < record.operandCount; ++n) {
+            instruction.operands.push_back(decodeOperand(record.operands[n]));
+        }
+        program.instructions.push_back(LinkedInstruction{ instruction, details->implementation, record.address });
+    }
+
+    return program;
+}
+
+} // namespace Interpreter::ProgramImage
@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include "global_state.h"
+#include "linker.h"
+#include "types.h"
+
+// A linked program as written by --emitImage. Every record has a fixed layout and is 8 byte aligned,
+// so the loader reads them straight out of the mapped file:
+//   ImageHeader, ImageRegion[regionCount], ImageSymbol[symbolCount], ImageInstruction[instructionCount],
+//   u64 pageIndices[pageCount], the string table, then page aligned at pagesOffset the content of each page.
+namespace Interpreter::ProgramImage
+{
+
+constexpr u32 FileVersion = 2;
+constexpr u32 NoString = ~0u;
+
+struct ImageHeader {
+    char magic[8];
+    u32 version;
+    u32 regionCount;
+    u64 entryPoint;
+    u64 symbolCount;
+    u64 instructionCount;
+    u64 pageCount;
+    u64 stringsSize;
+    u64 pagesOffset;
+};
+
+struct ImageRegion {
+    u64 start;
+    u64 length;
+    u8 read;
+    u8 write;
+    u8 execute;
+    u8 padding[5];
+};
+
+struct ImageSymbol {
+    u32 name; // offset in the string table
+    u32 kind; // Symbol::Kind
+    u64 address; // value of immediates
+    u64 size;
+};
+
+// Operands are stored linked, symbols and labels have already been resolved
+struct ImageOperand {
+    u8 type; // Ast::OperandType
+    u8 registerWidth;
+    u8 registerIndex;
+    u8 baseWidth; // 0 without base
+    u8 baseIndex;
+    u8 indexWidth; // 0 without index
+    u8 indexIndex;
+    u8 scale; // Ast::Scale + 1, 0 without scale
+    u8 hasDisplacement;
+    u8 padding[7];
+    u64 value; // immediate, relative target or displacement
+};
+
+struct ImageInstruction {
+    u32 mnemonic; // offset in the string table
+    u32 prefix;   // offset in the string table or NoString
+    u64 address;
+    u8 width;     // Ast::Width of the suffix, 0 without suffix
+    u8 operandWidth;
+    u8 condCode;  // Ast::CondCode + 1, 0 without condition
+    u8 operandCount;
+    u8 padding[4];
+    ImageOperand operands[2];
+};
+
+static_assert(sizeof(ImageHeader) == 64 && sizeof(ImageRegion) == 24 && sizeof(ImageSymbol) == 24);
+static_assert(sizeof(ImageOperand) == 24 && sizeof(ImageInstruction) == 72);
+
+bool isImage(const std::filesystem::path& path);
+
+// Writes the sections, symbols and instructions of a linked program
+bool write(const std::filesystem::path& path, GlobalState& globalState, const LinkedProgram& program);
+
+// Maps the image and installs its pages as guest memory without copying them, the returned program
+// is ready to run like the result of link
+LinkedProgram load(const std::filesystem::path& path, GlobalState& globalState);
+
+} // namespace Interpreter::ProgramImage
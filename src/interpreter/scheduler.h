@@ -0,0 +1,84 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <utility>
+#include <vector>
+
+#include "io_backend.h"
+#include "syscalls.h"
+
+namespace Interpreter
+{
+
+// Execution of one guest program, suspended while it waits for guest I/O
+class VmTask {
+    public:
+        struct promise_type {
+            VmTask get_return_object() {
+                return VmTask{ std::coroutine_handle<promise_type>::from_promise(*this) };
+            }
+            std::suspend_always initial_suspend() noexcept {
+                return {};
+            }
+            std::suspend_always final_suspend() noexcept {
+                return {};
+            }
+            void return_void() {}
+            void unhandled_exception() {
+                std::terminate();
+            }
+        };
+
+        explicit VmTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+        VmTask(VmTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+        VmTask(const VmTask&) = delete;
+        VmTask& operator=(const VmTask&) = delete;
+        ~VmTask() {
+            if (handle) {
+                handle.destroy();
+            }
+        }
+
+        std::coroutine_handle<> getHandle() const {
+            return handle;
+        }
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+};
+
+// Runs the VMs of a host thread, while one of them waits for I/O the others keep executing
+class Scheduler {
+    public:
+        void spawn(VmTask task) {
+            ready.push_back(task.getHandle());
+            tasks.push_back(std::move(task));
+        }
+
+        void run() {
+            while (true) {
+                if (!ready.empty()) {
+                    std::coroutine_handle<> handle = ready.front();
+                    ready.pop_front();
+                    handle.resume();
+                    continue;
+                }
+                // VMs only wait for I/O with --asyncIo, otherwise the thread never sets up a ring
+                if (!Syscalls::asyncIo || IoBackend::local().getPendingCount() == 0) {
+                    break;
+                }
+                IoBackend::local().waitForCompletions(ready);
+            }
+        }
+
+    private:
+        std::vector<VmTask> tasks;
+        std::deque<std::coroutine_handle<>> ready;
+};
+
+} // namespace Interpreter
@@ -7,11 +7,11 @@
 
 void selfTestCPU() {
     GlobalState globalState{};
-    Ast::Operand operandRAX{ Parser::registerTable.at("rax") };
-    Ast::Operand operandEAX{ Parser::registerTable.at("eax") };
-    Ast::Operand operandAX{ Parser::registerTable.at("ax") };
-    Ast::Operand operandAH{ Parser::registerTable.at("ah") };
-    Ast::Operand operandAL{ Parser::registerTable.at("al") };
+    Ast::Operand operandRAX{ *Parser::findRegister("rax") };
+    Ast::Operand operandEAX{ *Parser::findRegister("eax") };
+    Ast::Operand operandAX{ *Parser::findRegister("ax") };
+    Ast::Operand operandAH{ *Parser::findRegister("ah") };
+    Ast::Operand operandAL{ *Parser::findRegister("al") };
 
     globalState.cpu.rax = 0x1234567890ABCDEF;
     if (globalState.cpu.eax != 0x90ABCDEF) {
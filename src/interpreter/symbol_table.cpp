@@ -0,0 +1,85 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <format>
+
+#include "symbol_table.h"
+
+SymbolTable::Id SymbolTable::intern(const std::string_view name) {
+    const Id id = names.intern(name);
+    if (id == symbols.size()) {
+        symbols.push_back(Symbol{ 0, 0, Symbol::Kind::Undefined });
+    }
+    return id;
+}
+
+Symbol& SymbolTable::addSymbol(const Id id, const u64 size) {
+    Symbol& symbol = symbols[id];
+    if (symbol.kind != Symbol::Kind::Undefined) {
+        LOG_ERROR("Symbol '{}' already defined!", names.get(id));
+    }
+    symbol = Symbol{ addressPointer, size };
+    addRange(addressPointer, size, id);
+    addressPointer += size;
+    return symbol;
+}
+
+Symbol SymbolTable::extendSymbol(const Id id, const u64 additionalSize) {
+    Symbol& symbol = symbols[id];
+    if (symbol.kind == Symbol::Kind::Undefined) {
+        LOG_ERROR("Symbol '{}' not defined!", names.get(id));
+    }
+    Symbol range = symbol;
+    range.address = addressPointer;
+    symbol.size += additionalSize;
+    addRange(addressPointer, additionalSize, id);
+    addressPointer += additionalSize;
+    return range;
+}
+
+void SymbolTable::setImmediate(const Id id, const u64 value) {
+    symbols[id] = Symbol{ value, 0, Symbol::Kind::Immediate };
+}
+
+void SymbolTable::insert(const std::string_view name, const Symbol& symbol) {
+    const Id id = intern(name);
+    symbols[id] = symbol;
+    if (symbol.kind == Symbol::Kind::Address) {
+        addRange(symbol.address, symbol.size, id);
+    }
+}
+
+void SymbolTable::addRange(const u64 start, const u64 size, const Id id) {
+    if (size == 0) {
+        return;
+    }
+    // consecutive instructions under one label grow the same range
+    if (!ranges.empty() && ranges.back().id == id && ranges.back().end == start) {
+        ranges.back().end += size;
+        return;
+    }
+    rangesSorted = rangesSorted && (ranges.empty() || ranges.back().end <= start);
+    ranges.push_back(Range{ start, start + size, id });
+}
+
+std::optional<SymbolTable::Id> SymbolTable::findByAddress(const u64 address) const {
+    if (!rangesSorted) {
+        std::ranges::sort(ranges, {}, &Range::start);
+        rangesSorted = true;
+    }
+    const auto it = std::ranges::upper_bound(ranges, address, {}, &Range::start);
+    if (it == ranges.begin() || std::prev(it)->end <= address) {
+        return std::nullopt;
+    }
+    return std::prev(it)->id;
+}
+
+std::string SymbolTable::symbolize(const u64 address) const {
+    const std::optional<Id> id = findByAddress(address);
+    if (!id.has_value()) {
+        return std::format("0x{:x}", address);
+    }
+    // counted from the first range, symbols extended later can have others in between
+    return std::format("{}+0x{:x}", names.get(*id), address - symbols[*id].address);
+}
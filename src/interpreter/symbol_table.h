@@ -3,56 +3,126 @@
 
 #pragma once
 
-#include <unordered_map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "logging.h"
+#include "string_pool.h"
 
 struct Symbol {
+    enum class Kind : u8 {
+        Address,
+        // assigned with 'name = . - other', address holds the value
+        Immediate,
+        // referenced but not defined yet
+        Undefined,
+    };
+
     u64 address;
     u64 size;
+    Kind kind = Kind::Address;
 };
 
+// Symbols are interned to dense IDs, so the linker looks a name up once and then only indexes.
+// Every range a symbol covers is kept in address order as well, for mapping addresses back to names.
 class SymbolTable {
-    private:
-        u64 addressPointer = 0;
-
     public:
-        std::unordered_map<std::string, Symbol> symbols;
+        using Id = StringPool::Id;
 
-        Symbol& addSymbol(std::string symbolName, u64 size) {
-            if (symbols.find(symbolName) != symbols.end()) {
-                LOG_ERROR("Symbol '{}' already defined!", symbolName);
-            }
-            symbols[symbolName] = (Symbol{ addressPointer, size });
-            addressPointer += size;
-            return symbols[symbolName];
+        SymbolTable() = default;
+
+        SymbolTable(const SymbolTable&) = delete;
+        SymbolTable& operator=(const SymbolTable&) = delete;
+
+        // The ID of name, an undefined symbol is created for names not seen before
+        Id intern(std::string_view name);
+
+        std::optional<Id> find(const std::string_view name) const {
+            return names.find(name);
         }
-        Symbol extendSymbol(std::string symbolName, u64 additionalSize) {
-            if (symbols.find(symbolName) == symbols.end()) {
-                LOG_ERROR("Symbol '{}' not defined!", symbolName);
-            }
 
-            Symbol newSymbol = symbols[symbolName];
-            newSymbol.address = addressPointer;
+        Symbol& get(const Id id) {
+            return symbols[id];
+        }
 
-            symbols[symbolName].size += additionalSize;
-            addressPointer += additionalSize;
+        const Symbol& get(const Id id) const {
+            return symbols[id];
+        }
 
-            return newSymbol;
+        std::string_view getName(const Id id) const {
+            return names.get(id);
         }
-        bool hasSymbol(std::string symbolName) {
-            return symbols.find(symbolName) != symbols.end();
+
+        u32 size() const {
+            return names.size();
+        }
+
+        void reserve(const u32 count) {
+            names.reserve(count);
+            symbols.reserve(count);
+        }
+
+        bool hasSymbol(const Id id) const {
+            return symbols[id].kind != Symbol::Kind::Undefined;
+        }
+
+        bool hasSymbol(const std::string_view name) const {
+            const std::optional<Id> id = find(name);
+            return id.has_value() && hasSymbol(*id);
         }
-        Symbol& findSymbol(std::string symbolName) {
-            if (symbols.find(symbolName) != symbols.end()) {
-                return symbols[symbolName];
+
+        // Places a new symbol at the address pointer
+        Symbol& addSymbol(Id id, u64 size);
+
+        Symbol& addSymbol(const std::string_view name, const u64 size) {
+            return addSymbol(intern(name), size);
+        }
+
+        // Grows a symbol by a range at the address pointer, the returned copy holds the address of that range
+        Symbol extendSymbol(Id id, u64 additionalSize);
+
+        void setImmediate(Id id, u64 value);
+
+        // Inserts a symbol that was placed elsewhere, like one read from a program image
+        void insert(std::string_view name, const Symbol& symbol);
+
+        Symbol& findSymbol(const std::string_view name) {
+            if (const std::optional<Id> id = find(name); id.has_value() && hasSymbol(*id)) {
+                return symbols[*id];
             }
-            LOG_ERROR("Symbol '{}' not found!", symbolName);
+            LOG_ERROR("Symbol '{}' not found!", name);
         }
 
-};
+        u64 getAddressPointer() const {
+            return addressPointer;
+        }
+
+        // Every output section has its own pointer, the linker switches between them
+        void setAddressPointer(const u64 address) {
+            addressPointer = address;
+        }
+
+        // The symbol whose ranges contain address
+        std::optional<Id> findByAddress(u64 address) const;
+
+        // 'name+0x10' for addresses inside a symbol, the plain address otherwise
+        std::string symbolize(u64 address) const;
+
+    private:
+        struct Range {
+            u64 start;
+            u64 end;
+            Id id;
+        };
+
+        u64 addressPointer = 0;
+        StringPool names;
+        std::vector<Symbol> symbols;
+        // sorted on the first lookup after symbols were placed below the last range
+        mutable std::vector<Range> ranges;
+        mutable bool rangesSorted = true;
 
-struct SymbolImmediate {
-    std::string name;
-    u64 value;
+        void addRange(u64 start, u64 size, Id id);
 };
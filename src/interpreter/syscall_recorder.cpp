@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstring>
+
+#include "logging.h"
+#include "syscall_recorder.h"
+
+namespace Interpreter
+{
+
+namespace {
+
+constexpr char Magic[8] = { 'A', 'C', 'R', 'E', 'P', 'L', 'A', 'Y' };
+
+} // namespace
+
+SyscallRecorder::~SyscallRecorder() {
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+}
+
+bool SyscallRecorder::startRecording(const std::filesystem::path& path) {
+    file = std::fopen(path.string().c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    std::fwrite(Magic, sizeof(Magic), 1, file);
+    put<u32>(FileVersion);
+    mode = Mode::Record;
+    return true;
+}
+
+bool SyscallRecorder::startReplay(const std::filesystem::path& path) {
+    file = std::fopen(path.string().c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char magic[sizeof(Magic)] = {};
+    if (std::fread(magic, sizeof(magic), 1, file) != 1 || std::memcmp(magic, Magic, sizeof(Magic)) != 0) {
+        LOG_ERROR("'{}' is not a syscall recording", path.string());
+    }
+    if (const u32 version = get<u32>(); version != FileVersion) {
+        LOG_ERROR("Syscall recording has version {}, expected {}", version, FileVersion);
+    }
+    mode = Mode::Replay;
+    return true;
+}
+
+// Each entry: u16 number, s64 result, u32 write count, then per write u64 address, u32 size and the data
+void SyscallRecorder::run(const u64 number, const Syscalls::SyscallHandler handler, CPU& cpu, Memory& memory) {
+    if (mode == Mode::Record) {
+        writes.clear();
+        memory.captureWrites(&writes);
+        handler(cpu, memory);
+        memory.captureWrites(nullptr);
+
+        put<u16>(static_cast<u16>(number));
+        put<s64>(static_cast<s64>(cpu.rax));
+        put<u32>(static_cast<u32>(writes.size()));
+        for (const CapturedWrite& write : writes) {
+            put<u64>(write.address);
+            put<u32>(static_cast<u32>(write.data.size()));
+            std::fwrite(write.data.data(), 1, write.data.size(), file);
+        }
+        return;
+    }
+
+    const u16 recordedNumber = get<u16>();
+    if (recordedNumber != number) {
+        LOG_ERROR("Replay diverged at syscall {}: recorded syscall {}, guest issued syscall {}", replayed, recordedNumber, number);
+    }
+    const s64 result = get<s64>();
+    const u32 writeCount = get<u32>();
+    std::vector<u8> data;
+    for (u32 i = 0; i < writeCount; ++i) {
+        const u64 address = get<u64>();
+        data.resize(get<u32>());
+        if (!data.empty() && std::fread(data.data(), 1, data.size(), file) != data.size()) {
+            LOG_ERROR("Replay log ended after {} syscalls", replayed);
+        }
+        if (!memory.writeBytes(address, data.data(), data.size())) {
+            LOG_ERROR("Replay diverged at syscall {}: guest buffer at 0x{:016x} is not writable", replayed, address);
+        }
+    }
+    cpu.rax = static_cast<u64>(result);
+    ++replayed;
+}
+
+} // namespace Interpreter
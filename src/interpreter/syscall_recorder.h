@@ -0,0 +1,74 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#include "logging.h"
+#include "memory.h"
+#include "registers.h"
+#include "syscalls.h"
+#include "types.h"
+
+namespace Interpreter
+{
+
+// Records the results and guest memory side effects of syscalls that depend on the host,
+// so a later run can replay them bit for bit without touching the host.
+class SyscallRecorder {
+    public:
+        static constexpr u32 FileVersion = 1;
+
+        enum class Mode {
+            Off,
+            Record,
+            Replay,
+        };
+
+        SyscallRecorder() = default;
+        ~SyscallRecorder();
+
+        SyscallRecorder(const SyscallRecorder&) = delete;
+        SyscallRecorder& operator=(const SyscallRecorder&) = delete;
+
+        bool startRecording(const std::filesystem::path& path);
+        bool startReplay(const std::filesystem::path& path);
+
+        bool isActive() const {
+            return mode != Mode::Off;
+        }
+
+        bool isReplaying() const {
+            return mode == Mode::Replay;
+        }
+
+        // Runs the handler while recording, or feeds back the recorded result when replaying
+        void run(u64 number, Syscalls::SyscallHandler handler, CPU& cpu, Memory& memory);
+
+    private:
+        Mode mode = Mode::Off;
+        std::FILE* file = nullptr;
+        std::vector<CapturedWrite> writes;
+        u64 replayed = 0;
+
+        template <typename T>
+        void put(const T& value) {
+            std::fwrite(&value, sizeof(T), 1, file);
+        }
+
+        template <typename T>
+        T get() {
+            T value{};
+            if (std::fread(&value, sizeof(T), 1, file) != 1) {
+                LOG_ERROR("Replay log ended after {} syscalls", replayed);
+            }
+            return value;
+        }
+};
+
+inline SyscallRecorder syscallRecorder;
+
+} // namespace Interpreter
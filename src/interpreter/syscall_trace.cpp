@@ -0,0 +1,105 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <format>
+#include <numeric>
+#include <string>
+
+#include "logging.h"
+#include "syscall_trace.h"
+
+namespace Interpreter
+{
+
+namespace {
+
+struct LogHeader {
+    char magic[8] = { 'A', 'C', 'T', 'R', 'A', 'C', 'E', '\0' };
+    u32 version = SyscallTracer::LogVersion;
+    u32 recordSize = sizeof(SyscallTracer::Record);
+};
+
+std::string formatDuration(const u64 nanoseconds) {
+    if (nanoseconds < 1'000) {
+        return std::format("{}ns", nanoseconds);
+    }
+    if (nanoseconds < 1'000'000) {
+        return std::format("{}us", nanoseconds / 1'000);
+    }
+    return std::format("{}ms", nanoseconds / 1'000'000);
+}
+
+} // namespace
+
+SyscallTracer::~SyscallTracer() {
+    if (log != nullptr) {
+        std::fclose(log);
+    }
+}
+
+bool SyscallTracer::enable(const std::filesystem::path& logPath) {
+    ring.resize(RingSize);
+    enabled = true;
+    if (logPath.empty()) {
+        return true;
+    }
+
+    log = std::fopen(logPath.string().c_str(), "wb");
+    if (log == nullptr) {
+        return false;
+    }
+    const LogHeader header{};
+    std::fwrite(&header, sizeof(header), 1, log);
+    return true;
+}
+
+void SyscallTracer::flushLog() {
+    // the ring is flushed whenever it is full, so the pending records never wrapped around twice
+    while (logged < written) {
+        const u64 start = logged % RingSize;
+        const u64 count = std::min<u64>(written - logged, RingSize - start);
+        std::fwrite(ring.data() + start, sizeof(Record), count, log);
+        logged += count;
+    }
+}
+
+void SyscallTracer::finish() {
+    if (!enabled) {
+        return;
+    }
+    if (log != nullptr) {
+        flushLog();
+        std::fclose(log);
+        log = nullptr;
+    }
+
+    std::vector<u32> numbers;
+    for (u32 number = 0; number < aggregates.size(); ++number) {
+        if (aggregates[number].calls != 0) {
+            numbers.push_back(number);
+        }
+    }
+    std::ranges::sort(numbers, [&](u32 left, u32 right) { return aggregates[left].totalTime > aggregates[right].totalTime; });
+
+    const u64 totalTime = std::accumulate(numbers.begin(), numbers.end(), u64{ 0 }, [&](u64 sum, u32 number) {
+        return sum + aggregates[number].totalTime;
+    });
+    LOG_INFO("Syscall summary: {} calls, {} in syscalls", written, formatDuration(totalTime));
+    for (const u32 number : numbers) {
+        const Aggregate& aggregate = aggregates[number];
+        LOG_INFO("  {:<14} {:>8} calls {:>6} errors {:>8} total {:>8} avg", Syscalls::syscallNames[number], aggregate.calls,
+                 aggregate.errors, formatDuration(aggregate.totalTime), formatDuration(aggregate.totalTime / aggregate.calls));
+
+        std::string histogram;
+        for (u32 bucket = 0; bucket < BucketCount; ++bucket) {
+            if (aggregate.histogram[bucket] != 0) {
+                const std::string bound = bucket == BucketCount - 1 ? "more" : "<" + formatDuration(u64{ 1 } << bucket);
+                histogram += std::format("{}{}: {}", histogram.empty() ? "" : ", ", bound, aggregate.histogram[bucket]);
+            }
+        }
+        LOG_INFO("    latency {}", histogram);
+    }
+}
+
+} // namespace Interpreter
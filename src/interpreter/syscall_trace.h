@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#include "registers.h"
+#include "syscalls.h"
+#include "types.h"
+
+namespace Interpreter
+{
+
+// Records every emulated syscall into a preallocated ring buffer and per-syscall aggregates.
+// Nothing is formatted while the guest runs, the summary is only built at exit.
+class SyscallTracer {
+    public:
+        static constexpr u32 RingSize = 1u << 16;
+        static constexpr u32 BucketCount = 32;
+        static constexpr u32 LogVersion = 1;
+
+        // One entry of the binary log, written as is
+        struct Record {
+            u64 number;
+            std::array<u64, 6> arguments;
+            s64 result;
+            u64 rip;
+            u64 duration;
+        };
+
+        struct Aggregate {
+            u64 calls = 0;
+            u64 errors = 0;
+            u64 totalTime = 0;
+            // bucket n counts calls that took less than 2^n ns
+            std::array<u64, BucketCount> histogram{};
+        };
+
+        SyscallTracer() = default;
+        ~SyscallTracer();
+
+        SyscallTracer(const SyscallTracer&) = delete;
+        SyscallTracer& operator=(const SyscallTracer&) = delete;
+
+        // The log is optional, without it the ring keeps the most recent calls
+        bool enable(const std::filesystem::path& logPath);
+
+        bool isEnabled() const {
+            return enabled;
+        }
+
+        static u64 now() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // Arguments are still in their registers after the handler ran, only rax holds the result
+        void record(const u64 number, const CPU& cpu, const u64 rip, const u64 startTime) {
+            const u64 duration = now() - startTime;
+            Record& entry = ring[written % RingSize];
+            entry = Record{ number, { cpu.rdi, cpu.rsi, cpu.rdx, cpu.r10, cpu.r8, cpu.r9 }, static_cast<s64>(cpu.rax), rip, duration };
+            ++written;
+            if (log != nullptr && written % RingSize == 0) {
+                flushLog();
+            }
+
+            Aggregate& aggregate = aggregates[number < Syscalls::SyscallCount ? number : Syscalls::SyscallCount - 1];
+            ++aggregate.calls;
+            aggregate.errors += static_cast<s64>(cpu.rax) < 0 && static_cast<s64>(cpu.rax) > -4096;
+            aggregate.totalTime += duration;
+            ++aggregate.histogram[std::min<u32>(std::bit_width(duration), BucketCount - 1)];
+        }
+
+        // Logs the per-syscall summary and writes the rest of the binary log
+        void finish();
+
+    private:
+        bool enabled = false;
+        std::vector<Record> ring;
+        u64 written = 0;
+        u64 logged = 0;
+        std::array<Aggregate, Syscalls::SyscallCount> aggregates{};
+        std::FILE* log = nullptr;
+
+        void flushLog();
+};
+
+inline SyscallTracer syscallTracer;
+
+} // namespace Interpreter
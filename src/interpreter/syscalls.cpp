@@ -1,54 +1,125 @@
 // SPDX-FileCopyrightText: Copyright 2025 AsmCube Project
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <random>
 #include <string>
+#include <vector>
 
 #ifdef _WIN32
     #include <io.h>
-    #define read  _read
-    #define write _write
-    #define open _open
+    #include "windows_stuff.h"
 #else
     #include <unistd.h>
     #include <fcntl.h>
+    #include <ctime>
+    #include <sys/mman.h>
+    #include <sys/random.h>
+    #include <sys/stat.h>
 #endif
 
+#include "syscall_recorder.h"
 #include "syscalls.h"
 
 namespace Interpreter::Syscalls
 {
 
-void syscall_read(CPU& cpu, Memory& memory) {
-    s32 fd = static_cast<u32>(cpu.rdi);
-    u64 bufAddress = cpu.rsi;
-    u64 count = static_cast<u32>(cpu.rdx);
+// Linux limits a single read or write to this many bytes
+constexpr u64 MaxTransferSize = 0x7ffff000;
+constexpr u64 MaxPathLength = 4096;
+constexpr u64 MaxIovecCount = 1024;
 
-    void* inputRaw = malloc(count);
+s64 hostResult(const s64 result) {
+    return result < 0 ? -static_cast<s64>(errno) : result;
+}
 
-    s64 readBytesCount = read(fd, inputRaw, count);
+s64 hostRead(const s32 fd, u8* data, const u64 size) {
+#ifdef _WIN32
+    return hostResult(_read(fd, data, static_cast<u32>(size)));
+#else
+    return hostResult(::read(fd, data, size));
+#endif
+}
+
+s64 hostPread(const s32 fd, u8* data, const u64 size, const s64 offset) {
+#ifdef _WIN32
+    const s64 position = _lseeki64(fd, 0, SEEK_CUR);
+    if (position < 0 || _lseeki64(fd, offset, SEEK_SET) < 0) {
+        return -static_cast<s64>(errno);
+    }
+    const s64 result = hostResult(_read(fd, data, static_cast<u32>(size)));
+    _lseeki64(fd, position, SEEK_SET);
+    return result;
+#else
+    return hostResult(::pread(fd, data, size, offset));
+#endif
+}
 
-    u8* input = static_cast<u8*>(inputRaw);
-    for (u32 i = 0; i < readBytesCount; ++i) {
-        memory.writeMemory<u8>(bufAddress + i, input[i]);
+s64 hostPwrite(const s32 fd, const u8* data, const u64 size, const s64 offset) {
+#ifdef _WIN32
+    const s64 position = _lseeki64(fd, 0, SEEK_CUR);
+    if (position < 0 || _lseeki64(fd, offset, SEEK_SET) < 0) {
+        return -static_cast<s64>(errno);
     }
+    const s64 result = hostResult(_write(fd, data, static_cast<u32>(size)));
+    _lseeki64(fd, position, SEEK_SET);
+    return result;
+#else
+    return hostResult(::pwrite(fd, data, size, offset));
+#endif
+}
 
-    free(inputRaw);
-    cpu.rax = readBytesCount;
+// Descriptors of the virtual filesystem never reach the host
+VirtualFileSystem* vfsFor(const s32 fd) {
+    return vfs != nullptr && vfs->isOpen(fd) ? vfs.get() : nullptr;
 }
 
-void syscall_write(CPU& cpu, Memory& memory) {
-    s32 fd = static_cast<u32>(cpu.rdi);
+// Copies data the host read into the guest buffer, the buffer was checked to be writable before reading
+s64 finishRead(Memory& memory, const u64 address, const std::vector<u8>& buffer, const s64 result) {
+    if (result > 0) {
+        memory.writeBytes(address, buffer.data(), result);
+    }
+    return result;
+}
+
+void syscall_read(CPU& cpu, Memory& memory) {
+    s32 fd = static_cast<s32>(cpu.rdi);
     u64 bufAddress = cpu.rsi;
-    u64 count = static_cast<u32>(cpu.rdx);
+    u64 count = std::min(cpu.rdx, MaxTransferSize);
 
-    auto* outputRaw = static_cast<u8*>(malloc(count));
-    for (u32 i = 0; i < count; ++i) {
-        memory.readMemory<u8>(bufAddress + i, outputRaw[i]);
+    if (VirtualFileSystem* fileSystem = vfsFor(fd)) {
+        cpu.rax = fileSystem->read(memory, fd, bufAddress, count);
+        return;
     }
-    s64 writtenBytesCount = write(fd, outputRaw, count);
-    free(outputRaw);
+    if (!memory.isWritable(bufAddress, count)) {
+        cpu.rax = -Errno::BadAddress;
+        return;
+    }
+    outputBuffer.flushBeforeRead(fd);
+    std::vector<u8> input(count);
+    cpu.rax = finishRead(memory, bufAddress, input, hostRead(fd, input.data(), count));
+}
+
+void syscall_write(CPU& cpu, Memory& memory) {
+    s32 fd = static_cast<s32>(cpu.rdi);
+    u64 bufAddress = cpu.rsi;
+    u64 count = std::min(cpu.rdx, MaxTransferSize);
 
-    cpu.rax = writtenBytesCount;
+    if (VirtualFileSystem* fileSystem = vfsFor(fd)) {
+        cpu.rax = fileSystem->write(memory, fd, bufAddress, count);
+        return;
+    }
+    // the range is checked before the copy is allocated, a bad pointer with a huge count only costs the check
+    if (!memory.isReadable(bufAddress, count)) {
+        cpu.rax = -Errno::BadAddress;
+        return;
+    }
+    std::vector<u8> output(count);
+    memory.readBytes(bufAddress, output.data(), count);
+    cpu.rax = hostResult(outputBuffer.append(fd, output.data(), count));
 }
 
 void syscall_open(CPU& cpu, Memory& memory) {
@@ -57,26 +128,557 @@ void syscall_open(CPU& cpu, Memory& memory) {
     u32 mode = static_cast<u32>(cpu.rdx);
 
     std::string path;
-    u8 byte = 1;
+    if (!memory.readString(pathAddress, path, MaxPathLength)) {
+        cpu.rax = -Errno::BadAddress;
+        return;
+    }
+    if (vfs != nullptr) {
+        cpu.rax = vfs->open(path, flags, mode);
+        return;
+    }
+#ifdef _WIN32
+    cpu.rax = hostResult(_open(path.c_str(), flags, mode));
+#else
+    cpu.rax = hostResult(::open(path.c_str(), static_cast<s32>(flags), mode));
+#endif
+}
+
+void syscall_close(CPU& cpu, Memory& memory) {
+    s32 fd = static_cast<s32>(cpu.rdi);
+
+    if (VirtualFileSystem* fileSystem = vfsFor(fd)) {
+        cpu.rax = fileSystem->close(fd);
+        return;
+    }
+    outputBuffer.release(fd);
+#ifdef _WIN32
+    cpu.rax = hostResult(_close(fd));
+#else
+    cpu.rax = hostResult(::close(fd));
+#endif
+}
+
+// Writes a value into the guest layout of a structure
+template <typename T>
+void storeField(std::vector<u8>& buffer, const u64 offset, const T value) {
+    std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+void syscall_fstat(CPU& cpu, Memory& memory) {
+    s32 fd = static_cast<s32>(cpu.rdi);
+    u64 statAddress = cpu.rsi;
+
+    // struct stat of x86-64 Linux
+    std::vector<u8> buffer(144);
+    if (VirtualFileSystem* fileSystem = vfsFor(fd)) {
+        constexpr u32 TypeDirectory = 0040000;
+        constexpr u32 TypeRegular = 0100000;
+        const VirtualFileSystem::Node& node = *fileSystem->getOpenFile(fd).node;
+        storeField<u64>(buffer, 8, node.inode);
+        storeField<u64>(buffer, 16, 1);
+        storeField<u32>(buffer, 24, node.directory ? TypeDirectory | 0755 : TypeRegular | 0644);
+        storeField<s64>(buffer, 48, node.data.size());
+        storeField<u64>(buffer, 56, PageSize);
+        storeField<u64>(buffer, 64, (node.data.size() + 511) / 512);
+        cpu.rax = memory.writeBytes(statAddress, buffer.data(), buffer.size()) ? 0 : -Errno::BadAddress;
+        return;
+    }
+
+    // buffered output counts towards the file size
+    outputBuffer.flush(fd);
+#ifdef _WIN32
+    struct _stat64 fileStat {};
+    if (_fstat64(fd, &fileStat) != 0) {
+        cpu.rax = -static_cast<s64>(errno);
+        return;
+    }
+    storeField<u64>(buffer, 72, fileStat.st_atime);
+    storeField<u64>(buffer, 88, fileStat.st_mtime);
+    storeField<u64>(buffer, 104, fileStat.st_ctime);
+#else
+    struct stat fileStat {};
+    if (fstat(fd, &fileStat) != 0) {
+        cpu.rax = -static_cast<s64>(errno);
+        return;
+    }
+    storeField<u64>(buffer, 56, fileStat.st_blksize);
+    storeField<u64>(buffer, 64, fileStat.st_blocks);
+    storeField<u64>(buffer, 72, fileStat.st_atim.tv_sec);
+    storeField<u64>(buffer, 80, fileStat.st_atim.tv_nsec);
+    storeField<u64>(buffer, 88, fileStat.st_mtim.tv_sec);
+    storeField<u64>(buffer, 96, fileStat.st_mtim.tv_nsec);
+    storeField<u64>(buffer, 104, fileStat.st_ctim.tv_sec);
+    storeField<u64>(buffer, 112, fileStat.st_ctim.tv_nsec);
+#endif
+    storeField<u64>(buffer, 0, fileStat.st_dev);
+    storeField<u64>(buffer, 8, fileStat.st_ino);
+    storeField<u64>(buffer, 16, fileStat.st_nlink);
+    storeField<u32>(buffer, 24, fileStat.st_mode);
+    storeField<u32>(buffer, 28, fileStat.st_uid);
+    storeField<u32>(buffer, 32, fileStat.st_gid);
+    storeField<u64>(buffer, 40, fileStat.st_rdev);
+    storeField<s64>(buffer, 48, fileStat.st_size);
+
+    cpu.rax = memory.writeBytes(statAddress, buffer.data(), buffer.size()) ? 0 : -Errno::BadAddress;
+}
+
+void syscall_lseek(CPU& cpu, Memory& memory) {
+    s32 fd = static_cast<s32>(cpu.rdi);
+    s64 offset = static_cast<s64>(cpu.rsi);
+    s32 whence = static_cast<s32>(cpu.rdx);
+
+    if (VirtualFileSystem* fileSystem = vfsFor(fd)) {
+        cpu.rax = fileSystem->lseek(fd, offset, whence);
+        return;
+    }
+    outputBuffer.flush(fd);
+#ifdef _WIN32
+    cpu.rax = hostResult(_lseeki64(fd, offset, whence));
+#else
+    cpu.rax = hostResult(::lseek(fd, offset, whence));
+#endif
+}
+
+void syscall_pread64(CPU& cpu, Memory& memory) {
+    s32 fd = static_cast<s32>(cpu.rdi);
+    u64 bufAddress = cpu.rsi;
+    u64 count = std::min(cpu.rdx, MaxTransferSize);
+    s64 offset = static_cast<s64>(cpu.r10);
+
+    if (VirtualFileSystem* fileSystem = vfsFor(fd)) {
+        cpu.rax = fileSystem->pread(memory, fd, bufAddress, count, offset);
+        return;
+    }
+    if (!memory.isWritable(bufAddress, count)) {
+        cpu.rax = -Errno::BadAddress;
+        return;
+    }
+    outputBuffer.flush(fd);
+    std::vector<u8> input(count);
+    cpu.rax = finishRead(memory, bufAddress, input, hostPread(fd, input.data(), count, offset));
+}
+
+void syscall_pwrite64(CPU& cpu, Memory& memory) {
+    s32 fd = static_cast<s32>(cpu.rdi);
+    u64 bufAddress = cpu.rsi;
+    u64 count = std::min(cpu.rdx, MaxTransferSize);
+    s64 offset = static_cast<s64>(cpu.r10);
+
+    if (VirtualFileSystem* fileSystem = vfsFor(fd)) {
+        cpu.rax = fileSystem->pwrite(memory, fd, bufAddress, count, offset);
+        return;
+    }
+    if (!memory.isReadable(bufAddress, count)) {
+        cpu.rax = -Errno::BadAddress;
+        return;
+    }
+    std::vector<u8> output(count);
+    memory.readBytes(bufAddress, output.data(), count);
+    outputBuffer.flush(fd);
+    cpu.rax = hostPwrite(fd, output.data(), count, offset);
+}
+
+struct Iovec {
+    u64 base;
+    u64 length;
+};
+
+// Reads the guest iovec array, returns the total length or a negated errno
+s64 readIovecs(Memory& memory, const u64 address, const u64 count, std::vector<Iovec>& iovecs) {
+    if (count > MaxIovecCount) {
+        return -Errno::InvalidArgument;
+    }
+    iovecs.resize(count);
+    if (!memory.readBytes(address, reinterpret_cast<u8*>(iovecs.data()), count * sizeof(Iovec))) {
+        return -Errno::BadAddress;
+    }
+    u64 total = 0;
+    for (const Iovec& iovec : iovecs) {
+        total += iovec.length;
+        if (iovec.length > MaxTransferSize || total > MaxTransferSize) {
+            return -Errno::InvalidArgument;
+        }
+    }
+    return static_cast<s64>(total);
+}
+
+void syscall_readv(CPU& cpu, Memory& memory) {
+    s32 fd = static_cast<s32>(cpu.rdi);
+
+    std::vector<Iovec> iovecs;
+    s64 total = readIovecs(memory, cpu.rsi, cpu.rdx, iovecs);
+    if (total < 0) {
+        cpu.rax = total;
+        return;
+    }
+    for (const Iovec& iovec : iovecs) {
+        if (!memory.isWritable(iovec.base, iovec.length)) {
+            cpu.rax = -Errno::BadAddress;
+            return;
+        }
+    }
+    if (VirtualFileSystem* fileSystem = vfsFor(fd)) {
+        s64 result = 0;
+        for (const Iovec& iovec : iovecs) {
+            const s64 count = fileSystem->read(memory, fd, iovec.base, iovec.length);
+            if (count < 0) {
+                cpu.rax = result > 0 ? result : count;
+                return;
+            }
+            result += count;
+            if (static_cast<u64>(count) < iovec.length) {
+                break;
+            }
+        }
+        cpu.rax = result;
+        return;
+    }
+
+    // one host read, scattered into the guest buffers afterwards
+    outputBuffer.flushBeforeRead(fd);
+    std::vector<u8> input(total);
+    s64 result = hostRead(fd, input.data(), input.size());
     u64 offset = 0;
-    while (byte != 0) {
-        memory.readMemory<u8>(pathAddress + offset, byte);
-        path += static_cast<char>(byte);
-        ++offset;
-    };
-    s32 result = open(path.c_str(), flags, mode);
+    for (const Iovec& iovec : iovecs) {
+        if (result <= 0 || offset >= static_cast<u64>(result)) {
+            break;
+        }
+        const u64 count = std::min<u64>(iovec.length, result - offset);
+        memory.writeBytes(iovec.base, input.data() + offset, count);
+        offset += count;
+    }
     cpu.rax = result;
 }
 
+void syscall_writev(CPU& cpu, Memory& memory) {
+    s32 fd = static_cast<s32>(cpu.rdi);
+
+    std::vector<Iovec> iovecs;
+    s64 total = readIovecs(memory, cpu.rsi, cpu.rdx, iovecs);
+    if (total < 0) {
+        cpu.rax = total;
+        return;
+    }
+
+    if (VirtualFileSystem* fileSystem = vfsFor(fd)) {
+        s64 result = 0;
+        for (const Iovec& iovec : iovecs) {
+            const s64 count = fileSystem->write(memory, fd, iovec.base, iovec.length);
+            if (count < 0) {
+                cpu.rax = result > 0 ? result : count;
+                return;
+            }
+            result += count;
+        }
+        cpu.rax = result;
+        return;
+    }
+
+    // gathered into one host write
+    std::vector<u8> output(total);
+    u64 offset = 0;
+    for (const Iovec& iovec : iovecs) {
+        if (!memory.readBytes(iovec.base, output.data() + offset, iovec.length)) {
+            cpu.rax = -Errno::BadAddress;
+            return;
+        }
+        offset += iovec.length;
+    }
+    cpu.rax = hostResult(outputBuffer.append(fd, output.data(), output.size()));
+}
+
+void syscall_clock_gettime(CPU& cpu, Memory& memory) {
+    u32 clockID = static_cast<u32>(cpu.rdi);
+    u64 timeAddress = cpu.rsi;
+
+    s64 seconds;
+    s64 nanoseconds;
+#ifdef _WIN32
+    constexpr u32 ClockRealtime = 0;
+    std::chrono::nanoseconds time = clockID == ClockRealtime ? std::chrono::system_clock::now().time_since_epoch()
+        : std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch());
+    seconds = time.count() / 1'000'000'000;
+    nanoseconds = time.count() % 1'000'000'000;
+#else
+    struct timespec time {};
+    if (clock_gettime(static_cast<clockid_t>(clockID), &time) != 0) {
+        cpu.rax = -static_cast<s64>(errno);
+        return;
+    }
+    seconds = time.tv_sec;
+    nanoseconds = time.tv_nsec;
+#endif
+    const s64 timespec[2] = { seconds, nanoseconds };
+    cpu.rax = memory.writeBytes(timeAddress, reinterpret_cast<const u8*>(timespec), sizeof(timespec)) ? 0 : -Errno::BadAddress;
+}
+
+bool prepareIo(CPU& cpu, Memory& memory, std::optional<IoRequest>& request) {
+    if (!IoBackend::local().isAsync() || (vfs != nullptr && (cpu.rax == 2 || vfs->isOpen(static_cast<s32>(cpu.rdi))))) {
+        return false;
+    }
+
+    // invalid guest buffers are left to the synchronous handlers, which report them
+    switch (cpu.rax) {
+        case 0:
+            {
+                s32 fd = static_cast<s32>(cpu.rdi);
+                u64 count = std::min(cpu.rdx, MaxTransferSize);
+                if (!memory.isWritable(cpu.rsi, count)) {
+                    return false;
+                }
+                outputBuffer.flushBeforeRead(fd);
+                request = IoRequest{ IoRequest::Operation::Read, fd, cpu.rsi };
+                request->buffer.resize(count);
+                return true;
+            }
+
+        case 1:
+            {
+                // small writes are better off in the write-combining buffer
+                if (outputBuffer.isEnabled()) {
+                    return false;
+                }
+                u64 count = std::min(cpu.rdx, MaxTransferSize);
+                if (!memory.isReadable(cpu.rsi, count)) {
+                    return false;
+                }
+                request = IoRequest{ IoRequest::Operation::Write, static_cast<s32>(cpu.rdi) };
+                request->buffer.resize(count);
+                memory.readBytes(cpu.rsi, request->buffer.data(), count);
+                return true;
+            }
+
+        case 2:
+            {
+                std::string path;
+                if (!memory.readString(cpu.rdi, path, MaxPathLength)) {
+                    return false;
+                }
+                request = IoRequest{ IoRequest::Operation::Open };
+                request->path = std::move(path);
+                request->flags = static_cast<u32>(cpu.rsi);
+                request->mode = static_cast<u32>(cpu.rdx);
+                return true;
+            }
+
+        default:
+            return false;
+    }
+}
+
+void completeIo(CPU& cpu, Memory& memory, const IoRequest& request) {
+    if (request.operation == IoRequest::Operation::Read) {
+        finishRead(memory, request.guestAddress, request.buffer, request.result);
+    }
+    else if (request.operation == IoRequest::Operation::Write) {
+        outputBuffer.countDirectWrite(request.fd, request.result);
+    }
+    cpu.rax = request.result;
+}
+
+Permission protectionToPermission(const u32 protection) {
+    constexpr u32 ProtRead = 0x1;
+    constexpr u32 ProtWrite = 0x2;
+    constexpr u32 ProtExec = 0x4;
+    return Permission{ (protection & ProtRead) != 0, (protection & ProtWrite) != 0, (protection & ProtExec) != 0 };
+}
+
+// Maps a host file, so its pages can be used as guest page storage without copying them
+s64 mapHostFile(const s32 fd, const u64 offset, const u64 length, const bool shared, const bool writable, Region& region) {
+#ifdef _WIN32
+    s64 fileSize = _filelengthi64(fd);
+    if (fileSize < 0) {
+        return -Errno::BadFileDescriptor;
+    }
+#else
+    struct stat fileStat {};
+    if (fstat(fd, &fileStat) != 0) {
+        return -Errno::BadFileDescriptor;
+    }
+    s64 fileSize = fileStat.st_size;
+#endif
+
+    // pages completely beyond the end of the file are not backed by anything
+    const u64 available = static_cast<u64>(fileSize) > offset ? alignToPage(static_cast<u64>(fileSize) - offset) : 0;
+    const u64 hostLength = std::min(length, available);
+    // private mappings are copy-on-write on the host as well, so they can always be written
+    region.backingWritable = !shared || writable;
+    region.backingSize = hostLength;
+    if (hostLength == 0) {
+        return 0;
+    }
+
+#ifdef _WIN32
+    void* view = nullptr;
+    u8* data = Win_MapFile(fd, offset, hostLength, shared, region.backingWritable, view);
+    if (data == nullptr) {
+        return -Errno::AccessDenied;
+    }
+    region.backing = std::shared_ptr<u8>(data, [view](u8*) { Win_UnmapFile(view); });
+#else
+    const int hostProtection = region.backingWritable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* data = ::mmap(nullptr, hostLength, hostProtection, shared ? MAP_SHARED : MAP_PRIVATE, fd, static_cast<off_t>(offset));
+    if (data == MAP_FAILED) {
+        return -static_cast<s64>(errno);
+    }
+    region.backing = std::shared_ptr<u8>(static_cast<u8*>(data), [hostLength](u8* pointer) { ::munmap(pointer, hostLength); });
+#endif
+    return 0;
+}
+
+void syscall_mmap(CPU& cpu, Memory& memory) {
+    constexpr u32 MapShared = 0x01;
+    constexpr u32 MapFixed = 0x10;
+    constexpr u32 MapAnonymous = 0x20;
+    constexpr u32 MapFixedNoReplace = 0x100000;
+
+    u64 address = cpu.rdi;
+    u64 length = cpu.rsi;
+    u32 protection = static_cast<u32>(cpu.rdx);
+    u32 flags = static_cast<u32>(cpu.r10);
+    s32 fd = static_cast<s32>(cpu.r8);
+    u64 offset = cpu.r9;
+
+    if (length == 0 || address % PageSize != 0 || offset % PageSize != 0 || alignToPage(length) < length) {
+        cpu.rax = -Errno::InvalidArgument;
+        return;
+    }
+    length = alignToPage(length);
+
+    if ((flags & (MapFixed | MapFixedNoReplace)) != 0) {
+        if (address + length < address || address + length > StackBase) {
+            cpu.rax = -Errno::NoMemory;
+            return;
+        }
+        if ((flags & MapFixedNoReplace) != 0 && !memory.isRangeFree(address, length)) {
+            cpu.rax = -Errno::Exists;
+            return;
+        }
+    }
+    else if (address == 0 || address + length < address || address + length > StackBase || !memory.isRangeFree(address, length)) {
+        // the address is only a hint
+        address = memory.findFreeRange(length);
+        if (address == 0) {
+            cpu.rax = -Errno::NoMemory;
+            return;
+        }
+    }
+
+    Region region{ address, length, protectionToPermission(protection), Region::Kind::Anonymous };
+    if ((flags & MapAnonymous) == 0) {
+        // the descriptor came from a recorded open and the recording has no file contents to map
+        if (syscallRecorder.isReplaying()) {
+            LOG_ERROR("mmap of file descriptor {} cannot be replayed, only anonymous mappings are supported with --replay", fd);
+        }
+        if (vfsFor(fd) != nullptr) {
+            cpu.rax = -Errno::NoDevice;
+            return;
+        }
+        region.kind = Region::Kind::File;
+        // the mapping has to see everything the guest wrote to the file so far
+        outputBuffer.flushAll();
+        if (s64 result = mapHostFile(fd, offset, length, (flags & MapShared) != 0, region.permission.write, region); result != 0) {
+            cpu.rax = result;
+            return;
+        }
+    }
+
+    memory.mapRegion(std::move(region));
+    cpu.rax = address;
+}
+
+void syscall_mprotect(CPU& cpu, Memory& memory) {
+    u64 address = cpu.rdi;
+    u64 length = cpu.rsi;
+    u32 protection = static_cast<u32>(cpu.rdx);
+
+    if (address % PageSize != 0 || alignToPage(length) < length) {
+        cpu.rax = -Errno::InvalidArgument;
+        return;
+    }
+    // shared file mappings can only become writable if the file was mapped writable on the host
+    if (protectionToPermission(protection).write) {
+        for (const auto& [start, region] : memory.getRegions()) {
+            const bool overlaps = start < address + alignToPage(length) && address < start + region.length;
+            if (region.kind == Region::Kind::File && !region.backingWritable && overlaps) {
+                cpu.rax = -Errno::AccessDenied;
+                return;
+            }
+        }
+    }
+    if (!memory.protectRegion(address, alignToPage(length), protectionToPermission(protection))) {
+        cpu.rax = -Errno::NoMemory;
+        return;
+    }
+    cpu.rax = 0;
+}
+
+void syscall_munmap(CPU& cpu, Memory& memory) {
+    u64 address = cpu.rdi;
+    u64 length = cpu.rsi;
+
+    if (length == 0 || address % PageSize != 0 || alignToPage(length) < length) {
+        cpu.rax = -Errno::InvalidArgument;
+        return;
+    }
+    memory.unmapRegion(address, alignToPage(length));
+    cpu.rax = 0;
+}
+
+void syscall_brk(CPU& cpu, Memory& memory) {
+    cpu.rax = memory.setProgramBreak(cpu.rdi);
+}
+
+void syscall_fsync(CPU& cpu, Memory& memory) {
+    s32 fd = static_cast<s32>(cpu.rdi);
+
+    if (vfsFor(fd) != nullptr) {
+        cpu.rax = 0;
+        return;
+    }
+    if (outputBuffer.flush(fd) < 0) {
+        cpu.rax = -static_cast<s64>(errno);
+        return;
+    }
+#ifdef _WIN32
+    cpu.rax = _commit(fd);
+#else
+    cpu.rax = fsync(fd) == 0 ? 0 : -static_cast<s64>(errno);
+#endif
+}
+
 void syscall_exit(CPU& cpu, Memory& memory) {
+    outputBuffer.flushAll();
     u32 exitCode = static_cast<u32>(cpu.rdi);
     LOG_INFO("Program finished with exit code {}", exitCode);
 }
 
 void syscall_getrandom(CPU& cpu, Memory& memory) {
     u64 bufAddress = cpu.rdi;
-    u32 count = static_cast<u32>(cpu.rsi);
+    u64 count = std::min(cpu.rsi, MaxTransferSize);
     u32 flags = static_cast<u32>(cpu.rdx);
+
+    std::vector<u8> buffer(count);
+#ifdef _WIN32
+    thread_local std::random_device randomDevice;
+    for (u64 i = 0; i < count; i += sizeof(u32)) {
+        const u32 value = randomDevice();
+        std::memcpy(buffer.data() + i, &value, std::min<u64>(sizeof(u32), count - i));
+    }
+    s64 result = static_cast<s64>(count);
+#else
+    // the host getrandom takes the same flags
+    s64 result = 0;
+    while (result < static_cast<s64>(count)) {
+        const s64 generated = ::getrandom(buffer.data() + result, count - result, flags);
+        if (generated < 0) {
+            cpu.rax = -static_cast<s64>(errno);
+            return;
+        }
+        result += generated;
+    }
+#endif
+    cpu.rax = memory.writeBytes(bufAddress, buffer.data(), result) ? result : -Errno::BadAddress;
 }
 
 } // namespace Interpreter::Syscalls
\ No newline at end of file
@@ -3,25 +3,119 @@
 
 #pragma once
 
-#include <unordered_map>
-#include <functional>
+#include <array>
+#include <memory>
+#include <optional>
+#include <string_view>
 
 #include "registers.h"
 #include "memory.h"
+#include "io_backend.h"
+#include "output_buffer.h"
+#include "vfs.h"
 
 namespace Interpreter::Syscalls
 {
 
+// Linux errno values, syscalls return them negated in rax
+namespace Errno {
+constexpr s64 BadFileDescriptor = 9;
+constexpr s64 NoMemory = 12;
+constexpr s64 BadAddress = 14;
+constexpr s64 AccessDenied = 13;
+constexpr s64 Exists = 17;
+constexpr s64 NoDevice = 19;
+constexpr s64 InvalidArgument = 22;
+} // namespace Errno
+
+inline OutputBuffer outputBuffer;
+inline bool asyncIo = false;
+// guest file I/O goes to the virtual filesystem instead of the host if set
+inline std::unique_ptr<VirtualFileSystem> vfs;
+
+// Turns read, write and open into a request for the io backend, returns false if the syscall has to run directly
+bool prepareIo(CPU& cpu, Memory& memory, std::optional<IoRequest>& request);
+void completeIo(CPU& cpu, Memory& memory, const IoRequest& request);
+
 void syscall_read(CPU& cpu, Memory& memory);
 void syscall_write(CPU& cpu, Memory& memory);
 void syscall_open(CPU& cpu, Memory& memory);
+void syscall_close(CPU& cpu, Memory& memory);
+void syscall_fstat(CPU& cpu, Memory& memory);
+void syscall_lseek(CPU& cpu, Memory& memory);
+void syscall_mmap(CPU& cpu, Memory& memory);
+void syscall_mprotect(CPU& cpu, Memory& memory);
+void syscall_munmap(CPU& cpu, Memory& memory);
+void syscall_brk(CPU& cpu, Memory& memory);
+void syscall_pread64(CPU& cpu, Memory& memory);
+void syscall_pwrite64(CPU& cpu, Memory& memory);
+void syscall_readv(CPU& cpu, Memory& memory);
+void syscall_writev(CPU& cpu, Memory& memory);
+void syscall_fsync(CPU& cpu, Memory& memory);
+void syscall_clock_gettime(CPU& cpu, Memory& memory);
 void syscall_exit(CPU& cpu, Memory& memory);
+void syscall_getrandom(CPU& cpu, Memory& memory);
+
+using SyscallHandler = void (*)(CPU&, Memory&);
+
+struct SyscallDefinition {
+    u64 number;
+    std::string_view name;
+    SyscallHandler handler;
+    // results depend on the host, so they are recorded and replayed
+    bool host;
+};
+
+// x86-64 syscall numbers are dense and below 512, so the handler is a single indexed load
+constexpr u32 SyscallCount = 512;
+constexpr u64 SyscallExit = 60;
+constexpr u64 SyscallExitGroup = 231;
 
-inline std::unordered_map<u32, void (*)(CPU&, Memory&)> syscallTable = {
-    {0,  syscall_read},
-    {1,  syscall_write},
-    {2,  syscall_open},
-    {60, syscall_exit},
+inline constexpr SyscallDefinition syscallDefinitions[] = {
+    {0,                "read",          syscall_read,          true},
+    {1,                "write",         syscall_write,         true},
+    {2,                "open",          syscall_open,          true},
+    {3,                "close",         syscall_close,         true},
+    {5,                "fstat",         syscall_fstat,         true},
+    {8,                "lseek",         syscall_lseek,         true},
+    {9,                "mmap",          syscall_mmap,          false},
+    {10,               "mprotect",      syscall_mprotect,      false},
+    {11,               "munmap",        syscall_munmap,        false},
+    {12,               "brk",           syscall_brk,           false},
+    {17,               "pread64",       syscall_pread64,       true},
+    {18,               "pwrite64",      syscall_pwrite64,      true},
+    {19,               "readv",         syscall_readv,         true},
+    {20,               "writev",        syscall_writev,        true},
+    {SyscallExit,      "exit",          syscall_exit,          false},
+    {74,               "fsync",         syscall_fsync,         true},
+    {228,              "clock_gettime", syscall_clock_gettime, true},
+    // guests are single threaded, so exiting the group is exiting the process
+    {SyscallExitGroup, "exit_group",    syscall_exit,          false},
+    {318,              "getrandom",     syscall_getrandom,     true},
 };
 
+inline constexpr std::array<SyscallHandler, SyscallCount> syscallTable = [] {
+    std::array<SyscallHandler, SyscallCount> table{};
+    for (const SyscallDefinition& definition : syscallDefinitions) {
+        table[definition.number] = definition.handler;
+    }
+    return table;
+}();
+
+inline constexpr std::array<bool, SyscallCount> hostSyscalls = [] {
+    std::array<bool, SyscallCount> host{};
+    for (const SyscallDefinition& definition : syscallDefinitions) {
+        host[definition.number] = definition.host;
+    }
+    return host;
+}();
+
+inline constexpr std::array<std::string_view, SyscallCount> syscallNames = [] {
+    std::array<std::string_view, SyscallCount> names{};
+    for (const SyscallDefinition& definition : syscallDefinitions) {
+        names[definition.number] = definition.name;
+    }
+    return names;
+}();
+
 } // namespace Interpreter::Syscalls
\ No newline at end of file
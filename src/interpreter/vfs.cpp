@@ -0,0 +1,307 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "logging.h"
+#include "vfs.h"
+
+namespace Interpreter
+{
+
+namespace {
+
+// Linux open flags and errno values, the guest sees the same values on every host
+constexpr u32 AccessModeMask = 0x3;
+constexpr u32 ReadOnly = 0x0;
+constexpr u32 WriteOnly = 0x1;
+constexpr u32 Create = 0x40;
+constexpr u32 Exclusive = 0x80;
+constexpr u32 Truncate = 0x200;
+constexpr u32 Append = 0x400;
+constexpr u32 Directory = 0x10000;
+
+constexpr s64 NoEntry = 2;
+constexpr s64 BadFileDescriptor = 9;
+constexpr s64 BadAddress = 14;
+constexpr s64 Exists = 17;
+constexpr s64 NotDirectory = 20;
+constexpr s64 IsDirectory = 21;
+constexpr s64 InvalidArgument = 22;
+constexpr s64 FileTooLarge = 27;
+
+constexpr s32 SeekSet = 0;
+constexpr s32 SeekCurrent = 1;
+constexpr s32 SeekEnd = 2;
+
+constexpr u64 TarBlockSize = 512;
+
+u64 parseOctal(const char* text, const u64 length) {
+    u64 value = 0;
+    for (u64 i = 0; i < length && text[i] >= '0' && text[i] <= '7'; ++i) {
+        value = value * 8 + (text[i] - '0');
+    }
+    return value;
+}
+
+} // namespace
+
+VirtualFileSystem::VirtualFileSystem() {
+    createNode("/", true);
+}
+
+std::string VirtualFileSystem::normalize(const std::string& path) {
+    // there is no working directory, relative paths start at the root
+    std::string normalized = (std::filesystem::path("/") / path).lexically_normal().generic_string();
+    while (normalized.size() > 1 && normalized.back() == '/') {
+        normalized.pop_back();
+    }
+    return normalized;
+}
+
+std::shared_ptr<VirtualFileSystem::Node> VirtualFileSystem::createNode(const std::string& path, const bool directory) {
+    auto node = std::make_shared<Node>();
+    node->directory = directory;
+    node->inode = nextInode++;
+    nodes[path] = node;
+    return node;
+}
+
+void VirtualFileSystem::addDirectory(const std::string& path) {
+    const std::string normalized = normalize(path);
+    if (normalized != "/") {
+        addDirectory(std::filesystem::path(normalized).parent_path().generic_string());
+    }
+    if (!nodes.contains(normalized)) {
+        createNode(normalized, true);
+    }
+}
+
+void VirtualFileSystem::addFile(const std::string& path, std::vector<u8> data) {
+    const std::string normalized = normalize(path);
+    addDirectory(std::filesystem::path(normalized).parent_path().generic_string());
+    createNode(normalized, false)->data = std::move(data);
+}
+
+u64 VirtualFileSystem::getFileCount() const {
+    return std::ranges::count_if(nodes, [](const auto& entry) { return !entry.second->directory; });
+}
+
+bool VirtualFileSystem::load(const std::filesystem::path& path) {
+    if (std::filesystem::is_directory(path)) {
+        return loadDirectory(path);
+    }
+    return loadArchive(path);
+}
+
+bool VirtualFileSystem::loadDirectory(const std::filesystem::path& path) {
+    std::error_code error;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(path, error)) {
+        const std::string guestPath = entry.path().lexically_relative(path).generic_string();
+        if (entry.is_directory()) {
+            addDirectory(guestPath);
+        }
+        else if (entry.is_regular_file()) {
+            std::ifstream in(entry.path(), std::ios::binary);
+            addFile(guestPath, std::vector<u8>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+        }
+    }
+    return !error;
+}
+
+// Plain ustar archives, only regular files and directories are taken over
+bool VirtualFileSystem::loadArchive(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    const std::vector<char> archive((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    u64 offset = 0;
+    while (offset + TarBlockSize <= archive.size()) {
+        const char* header = archive.data() + offset;
+        if (std::all_of(header, header + TarBlockSize, [](char c) { return c == 0; })) {
+            return true;
+        }
+
+        std::string name(header, strnlen(header, 100));
+        if (std::memcmp(header + 257, "ustar", 5) == 0 && header[345] != 0) {
+            name = std::string(header + 345, strnlen(header + 345, 155)) + "/" + name;
+        }
+        const u64 size = parseOctal(header + 124, 12);
+        const char type = header[156];
+        offset += TarBlockSize;
+        if (offset + size > archive.size()) {
+            return false;
+        }
+
+        if (type == '0' || type == '\0') {
+            addFile(name, std::vector<u8>(archive.begin() + offset, archive.begin() + offset + size));
+        }
+        else if (type == '5') {
+            addDirectory(name);
+        }
+        offset += (size + TarBlockSize - 1) / TarBlockSize * TarBlockSize;
+    }
+    return true;
+}
+
+s64 VirtualFileSystem::open(const std::string& path, const u32 flags, u32) {
+    const std::string normalized = normalize(path);
+    std::shared_ptr<Node> node;
+    if (auto it = nodes.find(normalized); it != nodes.end()) {
+        node = it->second;
+        if ((flags & Create) != 0 && (flags & Exclusive) != 0) {
+            return -Exists;
+        }
+        if (node->directory && (flags & AccessModeMask) != ReadOnly) {
+            return -IsDirectory;
+        }
+        if (!node->directory && (flags & Directory) != 0) {
+            return -NotDirectory;
+        }
+        if ((flags & Truncate) != 0 && (flags & AccessModeMask) != ReadOnly) {
+            node->data.clear();
+        }
+    }
+    else {
+        if ((flags & Create) == 0) {
+            return -NoEntry;
+        }
+        auto parent = nodes.find(std::filesystem::path(normalized).parent_path().generic_string());
+        if (parent == nodes.end()) {
+            return -NoEntry;
+        }
+        if (!parent->second->directory) {
+            return -NotDirectory;
+        }
+        node = createNode(normalized, false);
+    }
+
+    s32 fd = 3;
+    while (openFiles.contains(fd)) {
+        ++fd;
+    }
+    openFiles[fd] = OpenFile{ node, 0, flags };
+    return fd;
+}
+
+s64 VirtualFileSystem::close(const s32 fd) {
+    return openFiles.erase(fd) != 0 ? 0 : -BadFileDescriptor;
+}
+
+s64 VirtualFileSystem::readAt(Memory& memory, const OpenFile& file, const u64 address, const u64 count, const u64 position) {
+    if ((file.flags & AccessModeMask) == WriteOnly) {
+        return -BadFileDescriptor;
+    }
+    if (file.node->directory) {
+        return -IsDirectory;
+    }
+    const std::vector<u8>& data = file.node->data;
+    const u64 available = position < data.size() ? std::min(count, data.size() - position) : 0;
+    if (available != 0 && !memory.writeBytes(address, data.data() + position, available)) {
+        return -BadAddress;
+    }
+    return static_cast<s64>(available);
+}
+
+s64 VirtualFileSystem::writeAt(Memory& memory, OpenFile& file, const u64 address, const u64 count, const u64 position) {
+    if ((file.flags & AccessModeMask) == ReadOnly) {
+        return -BadFileDescriptor;
+    }
+    if (count > MaxFileSize || position > MaxFileSize - count) {
+        return -FileTooLarge;
+    }
+    if (!memory.isReadable(address, count)) {
+        return -BadAddress;
+    }
+    std::vector<u8>& data = file.node->data;
+    if (position + count > data.size()) {
+        data.resize(position + count);
+    }
+    memory.readBytes(address, data.data() + position, count);
+    return static_cast<s64>(count);
+}
+
+s64 VirtualFileSystem::read(Memory& memory, const s32 fd, const u64 address, const u64 count) {
+    auto it = openFiles.find(fd);
+    if (it == openFiles.end()) {
+        return -BadFileDescriptor;
+    }
+    const s64 result = readAt(memory, it->second, address, count, it->second.position);
+    if (result > 0) {
+        it->second.position += result;
+    }
+    return result;
+}
+
+s64 VirtualFileSystem::write(Memory& memory, const s32 fd, const u64 address, const u64 count) {
+    auto it = openFiles.find(fd);
+    if (it == openFiles.end()) {
+        return -BadFileDescriptor;
+    }
+    OpenFile& file = it->second;
+    if ((file.flags & Append) != 0) {
+        file.position = file.node->data.size();
+    }
+    const s64 result = writeAt(memory, file, address, count, file.position);
+    if (result > 0) {
+        file.position += result;
+    }
+    return result;
+}
+
+s64 VirtualFileSystem::pread(Memory& memory, const s32 fd, const u64 address, const u64 count, const s64 offset) {
+    auto it = openFiles.find(fd);
+    if (it == openFiles.end()) {
+        return -BadFileDescriptor;
+    }
+    if (offset < 0) {
+        return -InvalidArgument;
+    }
+    return readAt(memory, it->second, address, count, offset);
+}
+
+s64 VirtualFileSystem::pwrite(Memory& memory, const s32 fd, const u64 address, const u64 count, const s64 offset) {
+    auto it = openFiles.find(fd);
+    if (it == openFiles.end()) {
+        return -BadFileDescriptor;
+    }
+    if (offset < 0) {
+        return -InvalidArgument;
+    }
+    return writeAt(memory, it->second, address, count, offset);
+}
+
+s64 VirtualFileSystem::lseek(const s32 fd, const s64 offset, const s32 whence) {
+    auto it = openFiles.find(fd);
+    if (it == openFiles.end()) {
+        return -BadFileDescriptor;
+    }
+    OpenFile& file = it->second;
+    s64 base;
+    switch (whence) {
+        case SeekSet:
+            base = 0;
+            break;
+        case SeekCurrent:
+            base = static_cast<s64>(file.position);
+            break;
+        case SeekEnd:
+            base = static_cast<s64>(file.node->data.size());
+            break;
+        default:
+            return -InvalidArgument;
+    }
+    // the position may lie past the end of the file, writes there are rejected once it passes MaxFileSize
+    if (offset < 0 ? base + offset < 0 : base > INT64_MAX - offset) {
+        return -InvalidArgument;
+    }
+    file.position = base + offset;
+    return static_cast<s64>(file.position);
+}
+
+} // namespace Interpreter
@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "memory.h"
+#include "types.h"
+
+namespace Interpreter
+{
+
+// In-process tmpfs-like file tree, guest file I/O is a copy between file buffers and guest pages
+// and never touches the host filesystem. Descriptors 0 to 2 stay with the host.
+class VirtualFileSystem {
+    public:
+        struct Node {
+            bool directory = false;
+            u64 inode = 0;
+            std::vector<u8> data;
+        };
+
+        struct OpenFile {
+            std::shared_ptr<Node> node;
+            u64 position = 0;
+            u32 flags = 0;
+        };
+
+        // Writes that would grow a file past this fail with EFBIG, like on a filesystem with a size limit
+        static constexpr u64 MaxFileSize = 1_GiB;
+
+        VirtualFileSystem();
+
+        // Preloads the tree from a host directory or a tar archive
+        bool load(const std::filesystem::path& path);
+        void addFile(const std::string& path, std::vector<u8> data);
+        void addDirectory(const std::string& path);
+
+        u64 getFileCount() const;
+
+        bool isOpen(const s32 fd) const {
+            return openFiles.contains(fd);
+        }
+
+        const OpenFile& getOpenFile(const s32 fd) const {
+            return openFiles.at(fd);
+        }
+
+        // All operations return the result like the Linux syscall, errors as negated errno.
+        // Nodes have no permissions, so the mode of open is accepted and ignored.
+        s64 open(const std::string& path, u32 flags, u32 mode);
+        s64 close(s32 fd);
+        s64 read(Memory& memory, s32 fd, u64 address, u64 count);
+        s64 write(Memory& memory, s32 fd, u64 address, u64 count);
+        s64 pread(Memory& memory, s32 fd, u64 address, u64 count, s64 offset);
+        s64 pwrite(Memory& memory, s32 fd, u64 address, u64 count, s64 offset);
+        s64 lseek(s32 fd, s64 offset, s32 whence);
+
+    private:
+        std::map<std::string, std::shared_ptr<Node>> nodes;
+        std::map<s32, OpenFile> openFiles;
+        u64 nextInode = 1;
+
+        static std::string normalize(const std::string& path);
+        std::shared_ptr<Node> createNode(const std::string& path, bool directory);
+        bool loadDirectory(const std::filesystem::path& path);
+        bool loadArchive(const std::filesystem::path& path);
+        s64 readAt(Memory& memory, const OpenFile& file, u64 address, u64 count, u64 position);
+        s64 writeAt(Memory& memory, OpenFile& file, u64 address, u64 count, u64 position);
+};
+
+} // namespace Interpreter
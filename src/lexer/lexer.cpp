@@ -1,16 +1,18 @@
 // SPDX-FileCopyrightText: Copyright 2025 AsmCube Project
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include <algorithm>
 #include <cctype>
-#include <filesystem>
-#include <string>
+#include <string_view>
 
 #include "lexer/lexer.h"
+#include "lexer/scan.h"
 #include "types.h"
 
-int lex(std::vector<std::string>& inputLines, std::vector<Token>& tokens) {
-    u32 lineNumber = 0;
+namespace {
 
+// Appends the tokens of one line, no lexer state carries over to the next line
+void lexLine(SourceFile& source, const std::string_view line, const u32 lineNumber, std::vector<Token>& tokens) {
     bool inString = false;
     bool inChar = false;
     bool buildingNumber = false;
@@ -31,223 +33,263 @@ int lex(std::vector<std::string>& inputLines, std::vector<Token>& tokens) {
         buildingHexNumber = false;
     };
 
-    for (const auto& line : inputLines) {
-        bool exitLoop = false;
-        bool firstDotWasSplitted = false;
+    bool exitLoop = false;
+    bool firstDotWasSplitted = false;
 
-        ++lineNumber;
+    // the source is not null terminated like a std::string
+    auto peek = [&](u32 position) {
+        return position < line.size() ? line[position] : '\0';
+    };
+    auto append = [&](u32 position, u32 count = 1) {
+        tokens.back().lexeme = source.extend(tokens.back().lexeme, line.data() + position, count);
+        tokens.back().length += count;
+    };
 
-        endCurrentLexemes();
+    const auto firstNonSpace = line.find_first_not_of(" \t");
+    if (firstNonSpace == std::string_view::npos) {
+        return;
+    }
 
-        const auto firstNonSpace = line.find_first_not_of(" \t");
-        if (firstNonSpace == std::string::npos) {
-            continue;
+    for (u32 i = 0; i < line.size(); ++i) {
+        u32& column = i;
+        const char c = line[i];
+        if (exitLoop) {
+            break;
         }
 
-        for (u32 i = 0; i < line.size(); ++i) {
-            u32& column = i;
-            const char c = line[i];
-            if (exitLoop) {
-                break;
+        // Fast paths for runs that leave the state untouched, everything else goes through the state machine
+        if (inString || inChar) {
+            if (const u32 run = Scan::scanRun(line.substr(i), Scan::CharClass::StringBody); run > 0) {
+                append(column, run);
+                i += run - 1;
+                continue;
+            }
+        }
+        else if (c == ' ' || c == '\t') {
+            endCurrentLexemes();
+            i += Scan::scanRun(line.substr(i), Scan::CharClass::Blank) - 1;
+            continue;
+        }
+        else if (buildingIdentifier || buildingRegister || buildingHexNumber || buildingNumber || buildingImmediate) {
+            // numbers and immediates only take digits, letters would start a new identifier
+            const bool takesLetters = buildingIdentifier || buildingRegister || buildingHexNumber;
+            u32 run = Scan::scanRun(line.substr(i), takesLetters ? Scan::CharClass::Identifier : Scan::CharClass::Digit);
+            // "0x" starts a hex number
+            run = std::min<u64>(run, line.substr(i, run + 1).find("0x"));
+            if (run > 0) {
+                append(column, run);
+                i += run - 1;
+                continue;
             }
+        }
 
-            const auto uc = static_cast<unsigned char>(c);
+        const auto uc = static_cast<unsigned char>(c);
 
-            if (c == '\"') {
-                if (!inString) {
-                    tokens.push_back(Token{ Token::Type::String, std::string{}, lineNumber, column, 0 });
-                    inString = true;
-                } else {
-                    inString = false;
-                }
-                continue;
+        if (c == '\"') {
+            if (!inString) {
+                tokens.push_back(Token{ Token::Type::String, line.substr(column + 1, 0), lineNumber, column, 0 });
+                inString = true;
+            } else {
+                inString = false;
             }
+            continue;
+        }
 
-            if (c == '\'') {
-                if (!inChar) {
-                    if (inString) {
-                        tokens.back().lexeme += c;
-                        tokens.back().length += 1;
-                        continue;
-                    }
-                    tokens.push_back(Token{ Token::Type::Char, std::string{}, lineNumber, column, 0 });
-                    inChar = true;
-                } else {
-                    inChar = false;
+        if (c == '\'') {
+            if (!inChar) {
+                if (inString) {
+                    append(column);
+                    continue;
                 }
-                continue;
+                tokens.push_back(Token{ Token::Type::Char, line.substr(column + 1, 0), lineNumber, column, 0 });
+                inChar = true;
+            } else {
+                inChar = false;
             }
+            continue;
+        }
 
-            if (inString || inChar) {
-                // accumulate raw characters
-                tokens.back().lexeme += c;
-                tokens.back().length += 1;
-                continue;
-            }
+        if (inString || inChar) {
+            // accumulate raw characters
+            append(column);
+            continue;
+        }
 
-            switch (c) {
-                case ' ':
-                    endCurrentLexemes();
-                    continue;
+        switch (c) {
+            case ' ':
+                endCurrentLexemes();
+                continue;
 
-                case '\t':
-                    endCurrentLexemes();
-                    continue;
+            case '\t':
+                endCurrentLexemes();
+                continue;
 
-                case '.':
-                    {
-                        if (buildingIdentifier) {
-                            tokens.back().lexeme += c;
-                            tokens.back().length += 1;
+            case '.':
+                {
+                    if (buildingIdentifier) {
+                        append(column);
+                    }
+                    else {
+                        if (column == firstNonSpace && !firstDotWasSplitted) {
+                            firstDotWasSplitted = true;
+                            endCurrentLexemes();
+                            tokens.push_back(Token{ Token::Type::Dot, line.substr(column, 1), lineNumber, column, 1 });
+                        }
+                        else if (firstDotWasSplitted && (std::isdigit(peek(column + 1)) || std::isalpha(peek(column + 1)) || line[column] == '_') || tokens.back().type == Token::Type::Identifier) {
+                            buildingIdentifier = true;
+                            tokens.push_back(Token{ Token::Type::Identifier, line.substr(column, 1), lineNumber, column, 1 });
                         }
                         else {
-                            if (column == firstNonSpace && !firstDotWasSplitted) {
-                                firstDotWasSplitted = true;
-                                endCurrentLexemes();
-                                tokens.push_back(Token{ Token::Type::Dot, ".", lineNumber, column, 1 });
-                            }
-                            else if (firstDotWasSplitted && (std::isdigit(line[column + 1]) || std::isalpha(line[column + 1]) || line[column] == '_') || tokens.back().type == Token::Type::Identifier) {
-                                buildingIdentifier = true;
-                                tokens.push_back(Token{ Token::Type::Identifier, std::string(1, c), lineNumber, column, 1 });
-                            }
-                            else {
-                                endCurrentLexemes();
-                                tokens.push_back(Token{ Token::Type::Dot, ".", lineNumber, column, 1 });
-                            }
+                            endCurrentLexemes();
+                            tokens.push_back(Token{ Token::Type::Dot, line.substr(column, 1), lineNumber, column, 1 });
                         }
                     }
-                    continue;
+                }
+                continue;
 
-                case ',':
-                    endCurrentLexemes();
-                    tokens.push_back(Token{ Token::Type::Comma, ",", lineNumber, column, 1 });
-                    continue;
+            case ',':
+                endCurrentLexemes();
+                tokens.push_back(Token{ Token::Type::Comma, line.substr(column, 1), lineNumber, column, 1 });
+                continue;
 
-                case ';':
-                    endCurrentLexemes();
-                    tokens.push_back(Token{ Token::Type::Semicolon, ";", lineNumber, column, 1 });
-                    continue;
+            case ';':
+                endCurrentLexemes();
+                tokens.push_back(Token{ Token::Type::Semicolon, line.substr(column, 1), lineNumber, column, 1 });
+                continue;
+
+            case '-':
+                {
+                    char nextChar = (i + 1 < line.size()) ? line[i + 1] : '\0';
+                    unsigned char unsignedNextChar = static_cast<unsigned char>(nextChar);
 
-                case '-':
-                    {
-                        char nextChar = (i + 1 < line.size()) ? line[i + 1] : '\0';
-                        unsigned char unsignedNextChar = static_cast<unsigned char>(nextChar);
-
-                        if (std::isdigit(unsignedNextChar) && !buildingIdentifier && !buildingRegister && !buildingSymbolType) {
-                            if (buildingImmediate) {
-                                tokens.back().lexeme += c;
-                                tokens.back().length += 1;
-                            }
-                            else {
-                                endCurrentLexemes();
-                                buildingNumber = true;
-                                tokens.push_back(Token{ Token::Type::NegativeNumber, "-", lineNumber, column, 1 });
-                            }
+                    if (std::isdigit(unsignedNextChar) && !buildingIdentifier && !buildingRegister && !buildingSymbolType) {
+                        if (buildingImmediate) {
+                            append(column);
                         }
                         else {
                             endCurrentLexemes();
-                            tokens.push_back(Token{ Token::Type::Dash, "-", lineNumber, column, 1 });
+                            buildingNumber = true;
+                            tokens.push_back(Token{ Token::Type::NegativeNumber, line.substr(column, 1), lineNumber, column, 1 });
                         }
                     }
-                    continue;
-
-                case ':':
-                    endCurrentLexemes();
-                    tokens.push_back(Token{ Token::Type::Colon, ":", lineNumber, column, 1 });
-                    continue;
+                    else {
+                        endCurrentLexemes();
+                        tokens.push_back(Token{ Token::Type::Dash, line.substr(column, 1), lineNumber, column, 1 });
+                    }
+                }
+                continue;
 
-                case '#':
-                    endCurrentLexemes();
-                    exitLoop = true;
-                    continue;
+            case ':':
+                endCurrentLexemes();
+                tokens.push_back(Token{ Token::Type::Colon, line.substr(column, 1), lineNumber, column, 1 });
+                continue;
 
-                case '$':
-                    endCurrentLexemes();
-                    buildingImmediate = true;
-                    tokens.push_back(Token{ Token::Type::Immediate, "$", lineNumber, column, 1 });
-                    continue;
+            case '#':
+                endCurrentLexemes();
+                exitLoop = true;
+                continue;
 
-                case '%':
-                    endCurrentLexemes();
-                    buildingRegister = true;
-                    tokens.push_back(Token{ Token::Type::Register, "%", lineNumber, column, 1 });
-                    continue;
+            case '$':
+                endCurrentLexemes();
+                buildingImmediate = true;
+                tokens.push_back(Token{ Token::Type::Immediate, line.substr(column, 1), lineNumber, column, 1 });
+                continue;
 
-                case '(':
-                    endCurrentLexemes();
-                    tokens.push_back(Token{ Token::Type::BracketOpen, "(", lineNumber, column, 1 });
-                    continue;
+            case '%':
+                endCurrentLexemes();
+                buildingRegister = true;
+                tokens.push_back(Token{ Token::Type::Register, line.substr(column, 1), lineNumber, column, 1 });
+                continue;
 
-                case ')':
-                    endCurrentLexemes();
-                    tokens.push_back(Token{ Token::Type::BracketClosed, ")", lineNumber, column, 1 });
-                    continue;
+            case '(':
+                endCurrentLexemes();
+                tokens.push_back(Token{ Token::Type::BracketOpen, line.substr(column, 1), lineNumber, column, 1 });
+                continue;
 
-                case '@':
-                    if (buildingIdentifier) {
-                        tokens.back().lexeme += c;
-                        tokens.back().length += 1;
-                    } else if (!buildingImmediate && !buildingRegister && !buildingNumber) {
-                        buildingSymbolType = true;
-                        tokens.push_back(Token{ Token::Type::SymbolType, "@", lineNumber, column, 1 });
-                    }
-                    continue;
+            case ')':
+                endCurrentLexemes();
+                tokens.push_back(Token{ Token::Type::BracketClosed, line.substr(column, 1), lineNumber, column, 1 });
+                continue;
 
-                case '=':
-                    endCurrentLexemes();
-                    tokens.push_back(Token{ Token::Type::Equal, "=", lineNumber, column, 1 });
-                    continue;
+            case '@':
+                if (buildingIdentifier) {
+                    append(column);
+                } else if (!buildingImmediate && !buildingRegister && !buildingNumber) {
+                    buildingSymbolType = true;
+                    tokens.push_back(Token{ Token::Type::SymbolType, line.substr(column, 1), lineNumber, column, 1 });
+                }
+                continue;
 
-                case '0':
-                    if (line[i + 1] == 'x') {
-                        buildingHexNumber = true;
-                        if (!buildingImmediate) {
-                            tokens.push_back(Token{ Token::Type::HexNumber, "0", lineNumber, column, 1 });
-                            continue;
-                        }
-                    }
+            case '=':
+                endCurrentLexemes();
+                tokens.push_back(Token{ Token::Type::Equal, line.substr(column, 1), lineNumber, column, 1 });
+                continue;
 
-                case 'x':
-                    if (buildingHexNumber && tokens.back().length == 1) {
-                        tokens.back().lexeme += c;
-                        tokens.back().length += 1;
+            case '0':
+                if (peek(i + 1) == 'x') {
+                    buildingHexNumber = true;
+                    if (!buildingImmediate) {
+                        tokens.push_back(Token{ Token::Type::HexNumber, line.substr(column, 1), lineNumber, column, 1 });
                         continue;
                     }
+                }
 
-                default:
-                    break;
-            }
-
-            if (std::isdigit(uc)) {
-                if (!buildingNumber && !buildingIdentifier && !buildingImmediate && !buildingRegister && !buildingHexNumber) {
-                    endCurrentLexemes();
-                    buildingNumber = true;
-                    tokens.push_back(Token{ Token::Type::Number, std::string(1, c), lineNumber, column, 1 });
-                } else {
-                    tokens.back().lexeme += c;
-                    tokens.back().length += 1;
+            case 'x':
+                if (buildingHexNumber && tokens.back().length == 1) {
+                    append(column);
+                    continue;
                 }
-                continue;
-            }
 
-            if (buildingHexNumber && std::isalpha(uc) && (std::tolower(uc) >= 'a' && std::tolower(uc) <= 'f')) {
-                tokens.back().lexeme += c;
-                tokens.back().length += 1;
-                continue;
+            default:
+                break;
+        }
+
+        if (std::isdigit(uc)) {
+            if (!buildingNumber && !buildingIdentifier && !buildingImmediate && !buildingRegister && !buildingHexNumber) {
+                endCurrentLexemes();
+                buildingNumber = true;
+                tokens.push_back(Token{ Token::Type::Number, line.substr(column, 1), lineNumber, column, 1 });
+            } else {
+                append(column);
             }
+            continue;
+        }
 
-            if (std::isalpha(uc) || c == '_') {
-                if (!buildingIdentifier && !buildingRegister && !buildingSymbolType && !buildingHexNumber) {
-                    endCurrentLexemes();
-                    buildingIdentifier = true;
-                    tokens.push_back(Token{ Token::Type::Identifier, std::string(1, c), lineNumber, column, 1 });
-                } else {
-                    tokens.back().lexeme += c;
-                    tokens.back().length += 1;
-                }
+        if (buildingHexNumber && std::isalpha(uc) && (std::tolower(uc) >= 'a' && std::tolower(uc) <= 'f')) {
+            append(column);
+            continue;
+        }
+
+        if (std::isalpha(uc) || c == '_') {
+            if (!buildingIdentifier && !buildingRegister && !buildingSymbolType && !buildingHexNumber) {
+                endCurrentLexemes();
+                buildingIdentifier = true;
+                tokens.push_back(Token{ Token::Type::Identifier, line.substr(column, 1), lineNumber, column, 1 });
+            } else {
+                append(column);
             }
         }
-        tokens.push_back(Token{ Token::Type::EOL, std::string{}, lineNumber, static_cast<u32>(inputLines[lineNumber - 1].length()), 0 });
+    }
+    tokens.push_back(Token{ Token::Type::EOL, line.substr(line.size()), lineNumber, static_cast<u32>(line.length()), 0 });
+}
+
+} // namespace
+
+bool Lexer::nextLine(std::vector<Token>& tokens) {
+    const std::string_view text = source.getText().substr(0, end);
+    const u64 tokenCount = tokens.size();
+    while (position < text.size() && tokens.size() == tokenCount) {
+        const u64 lineEnd = std::min(text.find('\n', position), text.size());
+        ++lineNumber;
+        lexLine(source, text.substr(position, lineEnd - position), lineNumber, tokens);
+        position = lineEnd + 1;
+    }
+    return tokens.size() != tokenCount;
+}
+
+int lex(SourceFile& source, std::vector<Token>& tokens) {
+    Lexer lexer(source);
+    while (lexer.nextLine(tokens)) {
     }
     return 0;
-};
+}
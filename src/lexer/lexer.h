@@ -3,12 +3,14 @@
 
 #pragma once
 
-#include <string>
+#include <string_view>
+#include <vector>
 
 #include <cereal/archives/json.hpp>
 #include <cereal/types/string.hpp>
 
 #include "cereal_overrides.h"
+#include "lexer/source_file.h"
 #include "types.h"
 
 struct Token {
@@ -33,7 +35,8 @@ struct Token {
         Equal,
     } type;
 
-    std::string lexeme;
+    // points into the SourceFile the token was lexed from
+    std::string_view lexeme;
     u32 line;
     u32 column;
     u32 length;
@@ -48,4 +51,25 @@ struct Token {
     }
 };
 
-int lex(std::vector<std::string>& inputLines, std::vector<Token>& tokens);
+// Lexes the source one line at a time, so the parser can start before the whole file is lexed
+class Lexer {
+    public:
+        explicit Lexer(SourceFile& source) : source(source), end(source.getText().size()) {}
+
+        // Lexes only the lines in [begin, end), begin has to be the start of a line and
+        // firstLine the number of lines before it
+        Lexer(SourceFile& source, const u64 begin, const u64 end, const u32 firstLine)
+            : source(source), position(begin), end(end), lineNumber(firstLine) {}
+
+        // Appends the tokens of the next line that has any, each ending in an EOL token.
+        // Returns false once the source is exhausted.
+        bool nextLine(std::vector<Token>& tokens);
+
+    private:
+        SourceFile& source;
+        u64 position = 0;
+        u64 end;
+        u32 lineNumber = 0;
+};
+
+int lex(SourceFile& source, std::vector<Token>& tokens);
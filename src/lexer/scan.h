@@ -0,0 +1,149 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <bit>
+#include <string_view>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ASMCUBE_SCAN_VECTORS
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ASMCUBE_SCAN_VECTORS
+#endif
+
+#include "types.h"
+
+// Classifies 16 or 32 source bytes at once so the lexer can take whole runs of
+// identifier, digit, blank or string characters in one step
+namespace Scan
+{
+
+enum class CharClass {
+    Identifier, // letters, digits and '_'
+    Digit,
+    Blank,      // ' ' and '\t'
+    StringBody, // anything but the quote characters
+};
+
+inline bool matches(const CharClass charClass, const char c) {
+    switch (charClass) {
+        case CharClass::Identifier:
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+        case CharClass::Digit:
+            return c >= '0' && c <= '9';
+        case CharClass::Blank:
+            return c == ' ' || c == '\t';
+        case CharClass::StringBody:
+            return c != '\"' && c != '\'';
+    }
+    return false;
+}
+
+#if defined(__AVX2__)
+
+using Vector = __m256i;
+constexpr u32 VectorSize = 32;
+
+inline Vector load(const char* data) {
+    return _mm256_loadu_si256(reinterpret_cast<const Vector*>(data));
+}
+
+inline Vector splat(const char c) {
+    return _mm256_set1_epi8(c);
+}
+
+inline Vector equal(const Vector a, const Vector b) {
+    return _mm256_cmpeq_epi8(a, b);
+}
+
+// bytes are compared signed, which keeps everything above 0x7f out of the ASCII ranges
+inline Vector inRange(const Vector chunk, const char low, const char high) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(chunk, splat(low - 1)), _mm256_cmpgt_epi8(splat(high + 1), chunk));
+}
+
+inline Vector either(const Vector a, const Vector b) {
+    return _mm256_or_si256(a, b);
+}
+
+inline u32 toMask(const Vector bytes) {
+    return static_cast<u32>(_mm256_movemask_epi8(bytes));
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+using Vector = __m128i;
+constexpr u32 VectorSize = 16;
+
+inline Vector load(const char* data) {
+    return _mm_loadu_si128(reinterpret_cast<const Vector*>(data));
+}
+
+inline Vector splat(const char c) {
+    return _mm_set1_epi8(c);
+}
+
+inline Vector equal(const Vector a, const Vector b) {
+    return _mm_cmpeq_epi8(a, b);
+}
+
+inline Vector inRange(const Vector chunk, const char low, const char high) {
+    return _mm_and_si128(_mm_cmpgt_epi8(chunk, splat(low - 1)), _mm_cmpgt_epi8(splat(high + 1), chunk));
+}
+
+inline Vector either(const Vector a, const Vector b) {
+    return _mm_or_si128(a, b);
+}
+
+inline u32 toMask(const Vector bytes) {
+    return static_cast<u32>(_mm_movemask_epi8(bytes));
+}
+
+#endif
+
+#ifdef ASMCUBE_SCAN_VECTORS
+
+// One bit per byte of the chunk that belongs to the class
+inline u32 classify(const Vector chunk, const CharClass charClass) {
+    switch (charClass) {
+        case CharClass::Identifier:
+            {
+                // setting bit 5 maps upper to lower case letters and no other byte into 'a'..'z'
+                const Vector letter = inRange(either(chunk, splat(0x20)), 'a', 'z');
+                return toMask(either(either(letter, inRange(chunk, '0', '9')), equal(chunk, splat('_'))));
+            }
+        case CharClass::Digit:
+            return toMask(inRange(chunk, '0', '9'));
+        case CharClass::Blank:
+            return toMask(either(equal(chunk, splat(' ')), equal(chunk, splat('\t'))));
+        case CharClass::StringBody:
+            return ~toMask(either(equal(chunk, splat('\"')), equal(chunk, splat('\''))));
+    }
+    return 0;
+}
+
+#endif
+
+// Number of characters at the start of text that belong to the class
+inline u64 scanRun(const std::string_view text, const CharClass charClass) {
+    u64 position = 0;
+#ifdef ASMCUBE_SCAN_VECTORS
+    // full chunks only, the source is mapped and reading past its end could fault
+    constexpr u32 FullMask = VectorSize == 32 ? ~0u : (1u << VectorSize) - 1;
+    while (position + VectorSize <= text.size()) {
+        const u32 mask = classify(load(text.data() + position), charClass) & FullMask;
+        if (mask != FullMask) {
+            return position + std::countr_one(mask);
+        }
+        position += VectorSize;
+    }
+#endif
+    while (position < text.size() && matches(charClass, text[position])) {
+        ++position;
+    }
+    return position;
+}
+
+} // namespace Scan
@@ -0,0 +1,94 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <fstream>
+#include <iterator>
+
+#ifdef WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <windows_stuff.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "lexer/source_file.h"
+
+SourceFile::~SourceFile() {
+    if (mapping == nullptr) {
+        return;
+    }
+#ifdef WIN32
+    Win_UnmapFile(mapping);
+#else
+    ::munmap(mapping, mappingSize);
+#endif
+}
+
+bool SourceFile::open(const std::filesystem::path& path) {
+    std::error_code error;
+    const u64 size = std::filesystem::file_size(path, error);
+    if (error) {
+        return false;
+    }
+
+    // empty files cannot be mapped and have nothing to lex anyway
+    if (size != 0) {
+#ifdef WIN32
+        const s32 fd = _wopen(path.c_str(), _O_RDONLY | _O_BINARY);
+        if (fd >= 0) {
+            const u8* data = Win_MapFile(fd, 0, size, true, false, mapping);
+            _close(fd);
+            if (data != nullptr) {
+                mappingSize = size;
+                text = std::string_view(reinterpret_cast<const char*>(data), size);
+                return true;
+            }
+        }
+#else
+        const s32 fd = ::open(path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (data != MAP_FAILED) {
+                ::madvise(data, size, MADV_SEQUENTIAL);
+                mapping = data;
+                mappingSize = size;
+                text = std::string_view(static_cast<const char*>(data), size);
+                return true;
+            }
+        }
+#endif
+    }
+
+    // pipes and special files are read into memory instead
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    text = buffer;
+    return true;
+}
+
+std::string_view SourceFile::extend(const std::string_view lexeme, const char* next, const u64 count) {
+    if (lexeme.data() + lexeme.size() == next) {
+        return std::string_view(lexeme.data(), lexeme.size() + count);
+    }
+    std::scoped_lock lock(spillMutex);
+    if (!spilled.empty() && spilled.back().data() == lexeme.data()) {
+        spilled.back().append(next, count);
+        return spilled.back();
+    }
+    std::string& copy = spilled.emplace_back(lexeme);
+    copy.append(next, count);
+    return copy;
+}
+
+std::string_view SourceFile::keep(const std::string_view text) {
+    std::scoped_lock lock(spillMutex);
+    return spilled.emplace_back(text);
+}
@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "types.h"
+
+// Owns the text every token lexeme points into. The input file is mapped read-only instead of
+// copied, so it has to outlive the tokens and every AST node that still holds a token.
+class SourceFile {
+    public:
+        SourceFile() = default;
+        ~SourceFile();
+
+        SourceFile(const SourceFile&) = delete;
+        SourceFile& operator=(const SourceFile&) = delete;
+
+        bool open(const std::filesystem::path& path);
+
+        std::string_view getText() const {
+            return text;
+        }
+
+        // Grows a lexeme by count source characters starting at next. Lexemes stay views into the source
+        // as long as they are contiguous, only those with skipped characters in between get their own copy.
+        // Safe to call from several lexers working on different parts of the file.
+        std::string_view extend(std::string_view lexeme, const char* next, u64 count = 1);
+
+        // Stores text that belongs to a lexeme but is not part of the source, like one read back from a cache
+        std::string_view keep(std::string_view text);
+
+    private:
+        std::string_view text;
+        void* mapping = nullptr;
+        u64 mappingSize = 0;
+        std::string buffer; // used when the file cannot be mapped
+        std::deque<std::string> spilled;
+        std::mutex spillMutex;
+};
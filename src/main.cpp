@@ -4,6 +4,9 @@
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <vector>
 
 #include <argparse/argparse.hpp>
 
@@ -15,7 +18,11 @@
 #include "lexer/lexer.h"
 #include "parser/parser.h"
 #include "interpreter/interpreter.h"
+#include "interpreter/program_image.h"
 #include "interpreter/self_test.h"
+#include "interpreter/syscall_recorder.h"
+#include "interpreter/syscall_trace.h"
+#include "interpreter/syscalls.h"
 #include "testcases/loader.h"
 
 #ifdef WIN32
@@ -25,8 +32,9 @@
 int main(int argc, char *argv[]) {
     argparse::ArgumentParser argumentParser("AsmCube");
 
-    argumentParser.add_argument("inputFile")
-        .help("path to input file")
+    argumentParser.add_argument("inputFiles")
+        .help("paths to the input files, several assembly files are parsed in parallel and linked into one program that needs its entry point declared with .globl _start")
+        .nargs(argparse::nargs_pattern::at_least_one)
         .required();
 
     argumentParser.add_argument("--dump")
@@ -34,11 +42,57 @@ int main(int argc, char *argv[]) {
         .default_value(false)
         .implicit_value(true);
 
+    argumentParser.add_argument("--frontendThreads")
+        .help("threads that lex and parse input files larger than 1 MiB in chunks and apply relocations of large programs, 0 uses every core and 1 streams line by line")
+        .default_value(0u)
+        .scan<'u', u32>();
+
+    argumentParser.add_argument("--cacheDir")
+        .help("keeps the parsed regions of the input in the given directory, later runs only parse the regions that changed");
+
+    argumentParser.add_argument("--lazyLink")
+        .help("lowers and relocates each function the first time it runs, errors in functions that never run are not reported")
+        .default_value(false)
+        .implicit_value(true);
+
+    argumentParser.add_argument("--sectionBases")
+        .help("page aligned start addresses of the output sections, like 'text=0x400000,rodata=0x600000', sections that are not listed keep their default");
+
+    argumentParser.add_argument("--emitImage")
+        .help("links the input and writes it as program image to the given file instead of running it");
+
     argumentParser.add_argument("--testMode")
         .help("enables test mode")
         .default_value(false)
         .implicit_value(true);
 
+    argumentParser.add_argument("--bufferOutput")
+        .help("combines small guest writes into large host writes")
+        .default_value(false)
+        .implicit_value(true);
+
+    argumentParser.add_argument("--asyncIo")
+        .help("submits guest read, write and open to io_uring")
+        .default_value(false)
+        .implicit_value(true);
+
+    argumentParser.add_argument("--vfs")
+        .help("runs guest file I/O on an in-memory filesystem preloaded from a directory or tar archive");
+
+    argumentParser.add_argument("--traceSyscalls")
+        .help("records every syscall and prints a summary with latency histograms at exit")
+        .default_value(false)
+        .implicit_value(true);
+
+    argumentParser.add_argument("--traceLog")
+        .help("writes the full syscall trace as binary log to the given file, implies --traceSyscalls");
+
+    argumentParser.add_argument("--record")
+        .help("records the results of host dependent syscalls to the given file");
+
+    argumentParser.add_argument("--replay")
+        .help("replays host dependent syscalls from a recording instead of running them on the host");
+
     argumentParser.add_argument("--logLevel")
         .help("log level (error, warning, info, debug)")
         .default_value(std::string("info"))
@@ -71,55 +125,140 @@ int main(int argc, char *argv[]) {
         std::exit(1);
     }
 
-    std::filesystem::path inputPath = std::filesystem::absolute(argumentParser.get<std::string>("inputFile"));
-    if (!std::filesystem::exists(inputPath)) {
-        LOG_ERROR("File '{}' does not exist!", inputPath.string());
+    const std::vector<std::string> inputFiles = argumentParser.get<std::vector<std::string>>("inputFiles");
+    std::vector<std::filesystem::path> inputPaths;
+    for (const std::string& inputFile : inputFiles) {
+        inputPaths.push_back(std::filesystem::absolute(inputFile));
+        if (!std::filesystem::exists(inputPaths.back())) {
+            LOG_ERROR("File '{}' does not exist!", inputPaths.back().string());
+        }
     }
+    const std::filesystem::path& inputPath = inputPaths.front();
+    const bool multiFile = inputPaths.size() > 1;
 
-    std::ifstream in(inputPath, std::ios::binary);
-    if (!in) {
-        LOG_ERROR("Failed to open file '{}'", inputPath.string());
+    // program images written by --emitImage are mapped and run without lexing, parsing or linking
+    const bool fromImage = Interpreter::ProgramImage::isImage(inputPath);
+    if (fromImage && multiFile) {
+        LOG_ERROR("A program image cannot be linked with other input files");
     }
 
-    std::vector<std::string> inputLines;
-    std::string line;
-    while (std::getline(in, line)) {
-        inputLines.push_back(line);
+    // tokens and the AST view into the sources, they stay mapped until the run is over
+    std::vector<SourceFile> sources(fromImage ? 0 : inputPaths.size());
+    for (u64 i = 0; i < sources.size(); ++i) {
+        if (!sources[i].open(inputPaths[i])) {
+            LOG_ERROR("Failed to open file '{}'", inputPaths[i].string());
+        }
     }
 
     selfTestCPU();
 
-    std::vector<Token> tokens;
-    auto startTime = std::chrono::high_resolution_clock::now();
-    lex(inputLines, tokens);
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
-    LOG_DEBUG("Lexing completed in {} ms, {} tokens generated.", duration, tokens.size());
-
-    if (argumentParser["--dump"] == true) {
-        const auto outputPath = std::filesystem::absolute("lex.json");
-        std::ofstream out(outputPath, std::ios::binary);
-        cereal::JSONOutputArchive archive(out);
-        archive(cereal::make_nvp("tokens", tokens));
-        LOG_INFO("Lexed tokens dumped to '{}'.", outputPath.string());
+    // small files without --dump are lexed, parsed and linked line by line
+    const bool dump = !fromImage && argumentParser["--dump"] == true;
+    if (dump && multiFile) {
+        LOG_ERROR("--dump only supports a single input file");
     }
-
+    const u32 frontendThreads = argumentParser.get<u32>("--frontendThreads");
+    std::optional<std::filesystem::path> cacheDirectory;
+    if (!fromImage && !dump && argumentParser.is_used("--cacheDir")) {
+        cacheDirectory = std::filesystem::absolute(argumentParser.get<std::string>("--cacheDir"));
+        std::error_code error;
+        std::filesystem::create_directories(*cacheDirectory, error);
+        if (error) {
+            LOG_ERROR("Failed to create the cache directory '{}': {}", cacheDirectory->string(), error.message());
+        }
+    }
+    const bool incremental = !multiFile && cacheDirectory.has_value();
+    const bool parallel = !fromImage && !dump && !multiFile && !incremental && frontendThreads != 1 && sources.front().getText().size() > Parser::ParallelChunkSize;
     Ast::Ast ast;
-    startTime = std::chrono::high_resolution_clock::now();
-    Parser::parse(tokens, ast);
-    endTime = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
-    LOG_DEBUG("Parsing completed in {} ms.", duration);
+    // one AST per input file of a program made of several
+    std::vector<std::unique_ptr<Ast::Ast>> objects;
+    if (multiFile) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        {
+            ThreadPool pool(frontendThreads);
+            objects = Parser::parseFiles(sources, pool, cacheDirectory);
+        }
+        auto endTime = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
+        LOG_DEBUG("Lexing and parsing {} files completed in {} ms.", objects.size(), duration);
+    }
+    else if (incremental) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        {
+            ThreadPool pool(frontendThreads);
+            Parser::parseIncremental(sources.front(), ast, pool, *cacheDirectory);
+        }
+        auto endTime = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
+        LOG_DEBUG("Lexing and parsing completed in {} ms.", duration);
+    }
+    else if (parallel) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        {
+            ThreadPool pool(frontendThreads);
+            Parser::parseParallel(sources.front(), ast, pool);
+            LOG_DEBUG("Lexing and parsing used {} threads.", pool.getThreadCount());
+        }
+        auto endTime = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
+        LOG_DEBUG("Lexing and parsing completed in {} ms.", duration);
+    }
+    else if (dump) {
+        std::vector<Token> tokens;
+        auto startTime = std::chrono::high_resolution_clock::now();
+        lex(sources.front(), tokens);
+        auto endTime = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
+        LOG_DEBUG("Lexing completed in {} ms, {} tokens generated.", duration, tokens.size());
 
-    if (argumentParser["--dump"] == true) {
-        const auto outputPath = std::filesystem::absolute("ast.json");
-        std::ofstream out(outputPath, std::ios::binary);
-        cereal::JSONOutputArchive archive(out);
-        archive(cereal::make_nvp("ast", ast));
-        LOG_INFO("AST dumped to '{}'.", outputPath.string());
+        const auto lexOutputPath = std::filesystem::absolute("lex.json");
+        std::ofstream lexOut(lexOutputPath, std::ios::binary);
+        cereal::JSONOutputArchive lexArchive(lexOut);
+        lexArchive(cereal::make_nvp("tokens", tokens));
+        LOG_INFO("Lexed tokens dumped to '{}'.", lexOutputPath.string());
+
+        startTime = std::chrono::high_resolution_clock::now();
+        Parser::parse(tokens, ast);
+        endTime = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
+        LOG_DEBUG("Parsing completed in {} ms.", duration);
+
+        const auto astOutputPath = std::filesystem::absolute("ast.json");
+        std::ofstream astOut(astOutputPath, std::ios::binary);
+        cereal::JSONOutputArchive astArchive(astOut);
+        astArchive(cereal::make_nvp("ast", ast));
+        LOG_INFO("AST dumped to '{}'.", astOutputPath.string());
     }
 
     GlobalState globalState{};
+    Interpreter::Syscalls::outputBuffer.setEnabled(argumentParser["--bufferOutput"] == true);
+    Interpreter::Syscalls::asyncIo = argumentParser["--asyncIo"] == true;
+    if (Interpreter::Syscalls::asyncIo && !Interpreter::IoBackend::local().isAsync()) {
+        LOG_WARNING("io_uring is not available, guest I/O is performed synchronously");
+    }
+    if (argumentParser["--traceSyscalls"] == true || argumentParser.is_used("--traceLog")) {
+        const std::filesystem::path traceLogPath = argumentParser.is_used("--traceLog") ? argumentParser.get<std::string>("--traceLog") : "";
+        if (!Interpreter::syscallTracer.enable(traceLogPath)) {
+            LOG_ERROR("Failed to open the syscall trace log '{}'", traceLogPath.string());
+        }
+    }
+    if (argumentParser.is_used("--record") && argumentParser.is_used("--replay")) {
+        LOG_ERROR("--record and --replay cannot be combined");
+    }
+    if (argumentParser.is_used("--record") && !Interpreter::syscallRecorder.startRecording(argumentParser.get<std::string>("--record"))) {
+        LOG_ERROR("Failed to create the syscall recording '{}'", argumentParser.get<std::string>("--record"));
+    }
+    if (argumentParser.is_used("--replay") && !Interpreter::syscallRecorder.startReplay(argumentParser.get<std::string>("--replay"))) {
+        LOG_ERROR("Failed to open the syscall recording '{}'", argumentParser.get<std::string>("--replay"));
+    }
+    if (argumentParser.is_used("--vfs")) {
+        const std::filesystem::path vfsPath = argumentParser.get<std::string>("--vfs");
+        Interpreter::Syscalls::vfs = std::make_unique<Interpreter::VirtualFileSystem>();
+        if (!Interpreter::Syscalls::vfs->load(vfsPath)) {
+            LOG_ERROR("Failed to load the virtual filesystem from '{}'", vfsPath.string());
+        }
+        LOG_DEBUG("Virtual filesystem loaded with {} files", Interpreter::Syscalls::vfs->getFileCount());
+    }
 
     if (argumentParser["--testMode"] == true) {
         globalState.testcase.testEnabled = true;
@@ -139,7 +278,45 @@ int main(int argc, char *argv[]) {
     }
     #endif
 
-    Interpreter::run(ast, globalState);
+    // images have to be complete, so they are always linked eagerly
+    Interpreter::LinkOptions linkOptions{ frontendThreads, argumentParser["--lazyLink"] == true && !argumentParser.is_used("--emitImage") };
+    if (const auto sectionBases = argumentParser.present("--sectionBases");
+        sectionBases.has_value() && !Interpreter::parseSectionBases(*sectionBases, linkOptions.sectionBases)) {
+        LOG_ERROR("Invalid section bases '{}', expected a list like 'text=0x400000,data=0x20000000' of page aligned addresses above the first page", *sectionBases);
+    }
+    Interpreter::LinkedProgram program;
+    if (fromImage) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        program = Interpreter::ProgramImage::load(inputPath, globalState);
+        auto endTime = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1'000'000.;
+        LOG_DEBUG("Program image loaded in {} ms.", duration);
+    }
+    else if (multiFile) {
+        std::vector<Interpreter::ObjectFile> objectFiles;
+        for (u64 i = 0; i < objects.size(); ++i) {
+            objectFiles.push_back(Interpreter::ObjectFile{ inputFiles[i], objects[i].get() });
+        }
+        program = Interpreter::link(objectFiles, globalState, linkOptions);
+    }
+    else if (dump || parallel || incremental) {
+        program = Interpreter::link(ast, globalState, linkOptions);
+    }
+    else {
+        Lexer lexer(sources.front());
+        program = Interpreter::link(lexer, globalState, linkOptions);
+    }
+
+    if (argumentParser.is_used("--emitImage")) {
+        const std::filesystem::path imagePath = std::filesystem::absolute(argumentParser.get<std::string>("--emitImage"));
+        if (!Interpreter::ProgramImage::write(imagePath, globalState, program)) {
+            LOG_ERROR("Failed to write the program image '{}'", imagePath.string());
+        }
+        LOG_INFO("Program image written to '{}'.", imagePath.string());
+    }
+    else {
+        Interpreter::run(std::move(program), globalState);
+    }
 
     #ifdef WIN32
     if (codePage != 65001) {
@@ -3,13 +3,21 @@
 
 #pragma once
 
-#include <string>
+#include <memory_resource>
 #include <optional>
+#include <span>
+#include <string_view>
 #include <variant>
+#include <vector>
 
 #include <cereal/archives/json.hpp>
+#include <cereal/types/vector.hpp>
 
+#include "arena.h"
+#include "inline_list.h"
+#include "string_pool.h"
 #include "types.h"
+#include "lexer/lexer.h"
 
 namespace Ast
 {
@@ -47,8 +55,11 @@ enum class CondCode {
     parityOdd,
 };
 
+// Labels, symbols and sections refer to their name through the StringPool of the AST
+using NameId = StringPool::Id;
+
 struct Label {
-    std::string name;
+    NameId name;
 
     template <class Archive>
     void serialize(Archive& archive) {
@@ -69,12 +80,13 @@ struct Directive {
         zero,
     };
     Name name;
-    std::vector<std::string> arguments;
+    // views into the source, the list itself lives in the arena of the AST
+    std::span<const std::string_view> arguments;
 
     template <class Archive>
-    void serialize(Archive& archive) {
+    void save(Archive& archive) const {
         archive(cereal::make_nvp("name", name),
-                cereal::make_nvp("arguments", arguments));
+                cereal::make_nvp("arguments", std::vector<std::string_view>(arguments.begin(), arguments.end())));
     }
 };
 
@@ -86,9 +98,10 @@ enum class Width : u8 {
 };
 
 struct Mnemonic {
-    std::string mnemonicName;
+    // both point at the keys of the static instruction tables
+    std::string_view mnemonicName;
 
-    std::string prefix;
+    std::string_view prefix;
     std::optional<Width> width;
 
     template <class Archive>
@@ -100,21 +113,26 @@ struct Mnemonic {
 };
 
 struct Register {
-    std::string name;
+    static constexpr u8 InstructionPointerIndex = 16;
+
     Width width;
     u8 index;
 
+    // r12b shares index 16 with rip, only the quad register is the instruction pointer
+    constexpr bool isRip() const {
+        return width == Width::Quad && index == InstructionPointerIndex;
+    }
+
     template <class Archive>
     void serialize(Archive& archive) {
         archive(
-            cereal::make_nvp("name", name),
             cereal::make_nvp("width", width),
             cereal::make_nvp("index", index));
     }
 };
 
 struct Symbol {
-    std::string name;
+    NameId name;
 
     template <class Archive>
     void serialize(Archive& archive) {
@@ -162,6 +180,8 @@ struct Memory {
 };
 
 using Operand = std::variant<Register, RelativeImmediate, Immediate, Memory, Symbol>;
+// no instruction takes more than two operands, keeping them inline makes instructions trivially copyable
+using Operands = InlineList<Operand, 2>;
 
 enum class OperandType {
     Register,
@@ -173,29 +193,31 @@ enum class OperandType {
 
 struct Instruction {
     Mnemonic mnemonic;
-    std::vector<Operand> operands;
-    Width operandWidth;
+    Operands operands;
+    // set by the linker when it lowers the instruction, the parser leaves it alone
+    Width operandWidth{};
     std::optional<std::variant<CondCode>> additionalData;
 
     template <class Archive>
-    void serialize(Archive& archive) {
+    void save(Archive& archive) const {
         archive(cereal::make_nvp("mnemonic", mnemonic),
-                cereal::make_nvp("items", operands),
+                cereal::make_nvp("items", std::vector<Operand>(operands.begin(), operands.end())),
                 cereal::make_nvp("additionalData", additionalData));
     }
 };
 
 struct Expression {
-    std::vector<Token> tokens;
+    // allocated from the arena of the AST
+    std::span<const Token> tokens;
 
     template <class Archive>
-    void serialize(Archive& archive) {
-        archive(cereal::make_nvp("tokens", tokens));
+    void save(Archive& archive) const {
+        archive(cereal::make_nvp("tokens", std::vector<Token>(tokens.begin(), tokens.end())));
     }
 };
 
 struct SymbolAssignment {
-    std::string name;
+    NameId name;
     Expression expression;
 
     template <class Archive>
@@ -205,9 +227,11 @@ struct SymbolAssignment {
     }
 };
 
+using Item = std::variant<Label, Directive, Instruction, SymbolAssignment>;
+
 struct Section {
-    std::string name;
-    std::vector<std::variant<Label, Directive, Instruction, SymbolAssignment>> items;
+    NameId name;
+    std::pmr::vector<Item> items;
 
     template <class Archive>
     void serialize(Archive& archive) {
@@ -216,6 +240,73 @@ struct Section {
         }
 };
 
-using Ast = std::vector<Section>;
+// Owns everything of one compilation. No node owns memory of its own: names are IDs into the
+// pool and every list is allocated from the arena, so dropping the whole tree is one arena reset.
+class Ast {
+    public:
+        Ast() = default;
+
+        Ast(const Ast&) = delete;
+        Ast& operator=(const Ast&) = delete;
+
+        Section& addSection(const NameId name) {
+            return sections.emplace_back(name, std::pmr::vector<Item>(&arena));
+        }
+
+        Section& addSection(const std::string_view name) {
+            return addSection(names.intern(name));
+        }
+
+        // Drops every section and item, the names stay interned
+        void reset() {
+            std::pmr::vector<Section>(&arena).swap(sections);
+            arena.reset();
+        }
+
+        template <typename T>
+        std::span<T> allocate(const u64 count) {
+            return arena.allocate<T>(count);
+        }
+
+        template <typename T>
+        std::span<const T> copy(const std::span<const T> items) {
+            return arena.copy(items);
+        }
+
+        NameId intern(const std::string_view name) {
+            return names.intern(name);
+        }
+
+        std::string_view getName(const NameId name) const {
+            return names.get(name);
+        }
+
+        const StringPool& getNames() const {
+            return names;
+        }
+
+        std::pmr::vector<Section>& getSections() {
+            return sections;
+        }
+
+        const std::pmr::vector<Section>& getSections() const {
+            return sections;
+        }
+
+        template <class Archive>
+        void save(Archive& archive) const {
+            std::vector<std::string_view> nameList;
+            for (NameId id = 0; id < names.size(); ++id) {
+                nameList.push_back(names.get(id));
+            }
+            archive(cereal::make_nvp("names", nameList),
+                    cereal::make_nvp("sections", sections));
+        }
+
+    private:
+        Arena arena;
+        StringPool names;
+        std::pmr::vector<Section> sections{ &arena };
+};
 
 } // namespace Ast
\ No newline at end of file
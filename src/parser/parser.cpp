@@ -2,12 +2,21 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <future>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
 #include <vector>
 
 #include "magic_enum_overrides.h"
 
 #include "lexer/lexer.h"
 #include "parser.h"
+#include "region_cache.h"
 #include "interpreter/mnemonics.h"
 
 #include "logging.h"
@@ -15,22 +24,22 @@
 namespace Parser
 {
 
-bool isNumber(const std::string& str) {
+bool isNumber(std::string_view str) {
     return !str.empty() && std::ranges::all_of(str, isdigit);
 }
 
-bool isNegativeNumber(const std::string& str) {
+bool isNegativeNumber(std::string_view str) {
     return str.size() > 1 && str[0] == '-' && std::ranges::all_of(str.begin() + 1, str.end(), isdigit);
 }
 
-bool isHexNumber(const std::string& str) {
+bool isHexNumber(std::string_view str) {
     return str.size() > 2 && str[0] == '0' && (str[1] == 'x') &&
            std::ranges::all_of(str.begin() + 2, str.end(), [](char c) {
                return std::isxdigit(std::tolower(static_cast<unsigned char>(c)));
            });
 }
 
-s64 textToNumber(const std::string& text) {
+s64 textToNumber(std::string_view text) {
     std::string tmpText;
     for (char c : text) {
         tmpText.push_back(std::tolower(static_cast<unsigned char>(c)));
@@ -43,16 +52,39 @@ s64 textToNumber(const std::string& text) {
     return std::stoll(tmpText, nullptr, 10);
 }
 
+std::optional<Ast::Register> findRegister(const std::string_view name) {
+    const RegisterInfo* info = registerTable.find(name);
+    if (info == nullptr) {
+        return std::nullopt;
+    }
+    return Ast::Register{ info->width, info->index };
+}
+
+bool isRegister(const u8 width, const u8 index) {
+    // a bit per index for each width of 8, 16, 32 and 64 bits
+    static constexpr std::array<u64, 4> registers = [] {
+        std::array<u64, 4> result{};
+        registerTable.forEach([&](std::string_view, const RegisterInfo& info) {
+            result[std::countr_zero(static_cast<u32>(info.width) / 8)] |= 1ull << info.index;
+        });
+        return result;
+    }();
+    if (width == 0 || width % 8 != 0 || !std::has_single_bit(static_cast<u32>(width)) || width > 64 || index >= 64) {
+        return false;
+    }
+    return (registers[std::countr_zero(static_cast<u32>(width) / 8)] >> index & 1) != 0;
+}
+
 Ast::Register makeRegister(const Token& token) {
-    const std::string name = token.lexeme.substr(1);
-    auto it = registerTable.find(name);
-    if (it == registerTable.end()) {
+    const std::string_view name = token.lexeme.substr(1);
+    std::optional<Ast::Register> reg = findRegister(name);
+    if (!reg.has_value()) {
         LOG_ERROR("Unknown register '{}' (line {} column {})", name, token.line, token.column);
     }
-    return it->second;
+    return *reg;
 }
 
-int parseOperand(Ast::Instruction& instruction, const std::vector<Token>& lineTokens, const u32 operandStart, const std::vector<u32>& operandCommaPositions) {
+int parseOperand(Ast::Ast& ast, Ast::Instruction& instruction, std::span<const Token> lineTokens, const u32 operandStart, const std::vector<u32>& operandCommaPositions) {
     u32 openBracketPosition = operandStart;
     bool hasDisplacement = false;
     if (lineTokens[operandStart].type != Token::Type::BracketOpen) {
@@ -82,7 +114,7 @@ int parseOperand(Ast::Instruction& instruction, const std::vector<Token>& lineTo
             {
                 // (base, index, scale)
                 Ast::Scale scale;
-                switch (std::stoull(lineTokens[operandCommaPositions[1] + 1].lexeme)) {
+                switch (textToNumber(lineTokens[operandCommaPositions[1] + 1].lexeme)) {
                     case 1:
                         scale = Ast::Scale::One;
                         break;
@@ -117,7 +149,7 @@ int parseOperand(Ast::Instruction& instruction, const std::vector<Token>& lineTo
             std::get<Ast::Memory>(instruction.operands.back()).disp = textToNumber(dispToken.lexeme);
         }
         else if (dispToken.type == Token::Type::Identifier) {
-            std::get<Ast::Memory>(instruction.operands.back()).disp = Ast::Label{ dispToken.lexeme };
+            std::get<Ast::Memory>(instruction.operands.back()).disp = Ast::Label{ ast.intern(dispToken.lexeme) };
         }
         else {
             LOG_ERROR("Not a valid displacement '{}' (line {} column {})", dispToken.lexeme, dispToken.line, dispToken.column);
@@ -126,7 +158,7 @@ int parseOperand(Ast::Instruction& instruction, const std::vector<Token>& lineTo
     return 0;
 }
 
-int parseOperands(Ast::Instruction& instruction, const std::vector<Token>& lineTokens) {
+int parseOperands(Ast::Ast& ast, Ast::Instruction& instruction, std::span<const Token> lineTokens) {
     std::vector<std::vector<u32>> operandCommaPositions { {} , {} };
     bool inParen = false;
     u32 parameterCommaPos = 0;
@@ -171,31 +203,31 @@ int parseOperands(Ast::Instruction& instruction, const std::vector<Token>& lineT
 
     if (parameterCommaPos != 0) {
         if (openBracketPositions[0] != 0) {
-            parseOperand(instruction, lineTokens, 1, operandCommaPositions[0]); // Prefix like rep not supported yet
+            parseOperand(ast, instruction, lineTokens, 1, operandCommaPositions[0]); // Prefix like rep not supported yet
         }
         else {
             if (lineTokens[1].type == Token::Type::Register) {
                 instruction.operands.push_back(makeRegister(lineTokens[1]));
             }
             else if (lineTokens[1].type == Token::Type::Immediate) {
-                std::string immediateValue = lineTokens[1].lexeme.substr(1); // Remove '$'
+                std::string_view immediateValue = lineTokens[1].lexeme.substr(1); // Remove '$'
                 if (isNumber(immediateValue) || isHexNumber(immediateValue) || isNegativeNumber(immediateValue)) {
                     instruction.operands.push_back(Ast::Immediate{static_cast<u64>(textToNumber(immediateValue)) });
                 }
                 else if (lineTokens[2].type == Token::Type::Identifier) {
-                    instruction.operands.push_back(Ast::Symbol{lineTokens[2].lexeme});
+                    instruction.operands.push_back(Ast::Symbol{ ast.intern(lineTokens[2].lexeme) });
                 }
             }
         }
         if (openBracketPositions[1] != 0) {
-            parseOperand(instruction, lineTokens, parameterCommaPos + 1, operandCommaPositions[1]); // Same here
+            parseOperand(ast, instruction, lineTokens, parameterCommaPos + 1, operandCommaPositions[1]); // Same here
         }
         else {
             if (lineTokens[parameterCommaPos + 1].type == Token::Type::Register) {
                 instruction.operands.push_back(makeRegister(lineTokens[parameterCommaPos + 1]));
             }
             else if (lineTokens[parameterCommaPos + 1].type == Token::Type::Immediate) {
-                std::string immediateValue = lineTokens[parameterCommaPos + 1].lexeme.substr(1); // Remove '$'
+                std::string_view immediateValue = lineTokens[parameterCommaPos + 1].lexeme.substr(1); // Remove '$'
                 if (isNumber(immediateValue) || isHexNumber(immediateValue)) {
                     instruction.operands.push_back(Ast::Immediate{static_cast<u64>(textToNumber(immediateValue)) });
                 }
@@ -205,13 +237,13 @@ int parseOperands(Ast::Instruction& instruction, const std::vector<Token>& lineT
     }
     else {
         if (lineTokens[1].type == Token::Type::Identifier) {
-            instruction.operands.push_back(Ast::Symbol{lineTokens[1].lexeme});
+            instruction.operands.push_back(Ast::Symbol{ ast.intern(lineTokens[1].lexeme) });
         }
         else if (lineTokens[1].type == Token::Type::Register) {
             instruction.operands.push_back(makeRegister(lineTokens[1]));
         }
         else if (lineTokens[1].type == Token::Type::Immediate) {
-            std::string immediateValue = lineTokens[1].lexeme.substr(1); // Remove '$'
+            std::string_view immediateValue = lineTokens[1].lexeme.substr(1); // Remove '$'
             if (isNumber(immediateValue) || isHexNumber(immediateValue)) {
                 instruction.operands.push_back(Ast::Immediate{static_cast<u64>(textToNumber(immediateValue)) });
             }
@@ -220,54 +252,7 @@ int parseOperands(Ast::Instruction& instruction, const std::vector<Token>& lineT
     return 0;
 }
 
-bool operandMatches(const Interpreter::Mnemonics::OperandSpec& spec, const Ast::Operand& operand) {
-    using OpType = Interpreter::Mnemonics::OpType;
-    switch (spec.type) {
-        case OpType::Register:
-            return std::holds_alternative<Ast::Register>(operand);
-
-        case OpType::Memory:
-        case OpType::MemoryNoSize:
-            return std::holds_alternative<Ast::Memory>(operand);
-
-        case OpType::RegisterOrMemory:
-            return std::holds_alternative<Ast::Register>(operand)
-                || std::holds_alternative<Ast::Memory>(operand);
-
-        case OpType::Immediate:
-            return std::holds_alternative<Ast::Immediate>(operand)
-                || std::holds_alternative<Ast::Symbol>(operand);
-
-        case OpType::Relative:
-            return std::holds_alternative<Ast::RelativeImmediate>(operand)
-                || std::holds_alternative<Ast::Symbol>(operand);
-    }
-    return false;
-}
-
-bool formMatches(const Interpreter::Mnemonics::InstructionForm& form, const std::vector<Ast::Operand>& operands) {
-    if (form.size() != operands.size()) {
-        return false;
-    }
-    for (u32 i = 0; i < operands.size(); ++i) {
-        if (!operandMatches(form[i], operands[i])) {
-            return false;
-        }
-    }
-    return true;
-}
-
-const std::vector<Interpreter::Mnemonics::OperandSpec>* findMatchingForm(
-    const Interpreter::Mnemonics::InstructionDetails& instructionDef, const std::vector<Ast::Operand>& operands) {
-    for (const auto& form : instructionDef.forms) {
-        if (formMatches(form, operands)) {
-            return &form;
-        }
-    }
-    return nullptr;
-}
-
-void resolveRelativeOperands(const Interpreter::Mnemonics::InstructionForm& form, std::vector<Ast::Operand>& operands) {
+void resolveRelativeOperands(const Interpreter::Mnemonics::InstructionForm& form, Ast::Operands& operands) {
     for (u32 i = 0; i < operands.size(); ++i) {
         if (form[i].type != Interpreter::Mnemonics::OpType::Relative) {
             continue;
@@ -279,183 +264,427 @@ void resolveRelativeOperands(const Interpreter::Mnemonics::InstructionForm& form
         }
     }
 }
-int parse(const std::vector<Token>& tokens, std::vector<Ast::Section>& ast) {
-    std::vector<std::vector<Token>> inputLines { std::vector<Token>{} };
-    u32 lineNumber = 0;
-    for (Token token : tokens) {
-        inputLines[lineNumber].push_back(token);
-
-        if (token.type == Token::Type::EOL) {
-            ++lineNumber;
-            inputLines.push_back(std::vector<Token>{});
-        }
-    }
 
-    for (const auto& lineTokens : inputLines) {
-        if (lineTokens.empty()) {
-            continue;
-        }
+int parseLine(const std::span<const Token> lineTokens, Ast::Ast& ast) {
+    std::pmr::vector<Ast::Section>& sections = ast.getSections();
+    if (lineTokens.empty()) {
+        return 0;
+    }
 
-        if (lineTokens[0].type == Token::Type::Dot) {
-            if (lineTokens[1].type == Token::Type::Identifier) {
-                if (lineTokens[1].lexeme == "section") {
-                    if (lineTokens[2].type == Token::Type::Identifier) {
-                        Ast::Section section = {lineTokens[2].lexeme.substr(1), {} };
-                        ast.push_back(section);
-                    }
-                }
-                else if (lineTokens[1].lexeme == "text" || lineTokens[1].lexeme == "data" || lineTokens[1].lexeme == "bss" || lineTokens[1].lexeme == "rodata") {
-                    Ast::Section section = {lineTokens [1].lexeme, {} };
-                    ast.push_back(section);
+    if (lineTokens[0].type == Token::Type::Dot) {
+        if (lineTokens[1].type == Token::Type::Identifier) {
+            if (lineTokens[1].lexeme == "section") {
+                if (lineTokens[2].type == Token::Type::Identifier) {
+                    ast.addSection(lineTokens[2].lexeme.substr(1));
                 }
-                else if (auto value = magic_enum::enum_cast<Ast::Directive::Name>(lineTokens[1].lexeme)) {
-                    Ast::Directive directive;
-                    directive.name = *value;
-                    for (u32 i = 2; i < lineTokens.size() - 1; ++i) { // Exclude EOL
-                        if (lineTokens[i].type == Token::Type::Comma) {
-                            continue;
-                        }
-                        directive.arguments.push_back(lineTokens[i].lexeme);
-                    }
-                    if (ast.empty()) {
-                        LOG_INFO("Implicit .text section created");
-                        ast.push_back(Ast::Section{ "text", {} });
+            }
+            else if (lineTokens[1].lexeme == "text" || lineTokens[1].lexeme == "data" || lineTokens[1].lexeme == "bss" || lineTokens[1].lexeme == "rodata") {
+                ast.addSection(lineTokens[1].lexeme);
+            }
+            else if (const Ast::Directive::Name* value = directiveNames.find(lineTokens[1].lexeme)) {
+                Ast::Directive directive;
+                directive.name = *value;
+                // sized for the worst case, the commas in between are skipped
+                std::span<std::string_view> arguments = ast.allocate<std::string_view>(lineTokens.size() - 3);
+                u64 argumentCount = 0;
+                for (u32 i = 2; i < lineTokens.size() - 1; ++i) { // Exclude EOL
+                    if (lineTokens[i].type == Token::Type::Comma) {
+                        continue;
                     }
-                    ast.back().items.push_back(directive);
-                }
-                else if (auto ignored = magic_enum::enum_cast<IgnoredDirectives>(lineTokens[1].lexeme)) {
-                    LOG_WARNING("Ignoring directive '{}' at line {} column {}", lineTokens[1].lexeme, lineTokens[1].line, lineTokens[1].column);
-                }
-                else if (lineTokens.size() == 4 && lineTokens[1].type == Token::Type::Identifier && lineTokens[2].type == Token::Type::Colon) {
-                    ast.back().items.push_back(Ast::Label{ "." + lineTokens[1].lexeme });
+                    arguments[argumentCount++] = lineTokens[i].lexeme;
                 }
-                else {
-                    LOG_WARNING("Unknown directive '{}' at line {} column {}", lineTokens[1].lexeme, lineTokens[1].line, lineTokens[1].column);
+                directive.arguments = arguments.first(argumentCount);
+                if (sections.empty()) {
+                    LOG_INFO("Implicit .text section created");
+                    ast.addSection("text");
                 }
+                sections.back().items.push_back(directive);
+            }
+            else if (ignoredDirectives.contains(lineTokens[1].lexeme)) {
+                LOG_WARNING("Ignoring directive '{}' at line {} column {}", lineTokens[1].lexeme, lineTokens[1].line, lineTokens[1].column);
+            }
+            else if (lineTokens.size() == 4 && lineTokens[1].type == Token::Type::Identifier && lineTokens[2].type == Token::Type::Colon) {
+                sections.back().items.push_back(Ast::Label{ ast.intern("." + std::string(lineTokens[1].lexeme)) });
+            }
+            else {
+                LOG_WARNING("Unknown directive '{}' at line {} column {}", lineTokens[1].lexeme, lineTokens[1].line, lineTokens[1].column);
             }
         }
+    }
+
+    if (lineTokens[0].type == Token::Type::Identifier) {
+        std::string_view mnemonicName {};
+        std::string_view prefix {};
+        std::string_view suffix {};
+        u8 mnemonicPos = 0;
+
+        if (Interpreter::Mnemonics::instructionPrefixes.contains(lineTokens[0].lexeme)) {
+            prefix = Interpreter::Mnemonics::instructionPrefixes.findKey(lineTokens[0].lexeme);
+            mnemonicPos = 1;
+        }
+        if (Interpreter::Mnemonics::instructionDefinitions.contains(lineTokens[mnemonicPos].lexeme)) {
+            mnemonicName = Interpreter::Mnemonics::instructionDefinitions.findKey(lineTokens[mnemonicPos].lexeme);
+        }
+        else if (Interpreter::Mnemonics::instructionDefinitions.contains(lineTokens[mnemonicPos].lexeme.substr(0, lineTokens[mnemonicPos].lexeme.size() - 1))) {
+            mnemonicName = Interpreter::Mnemonics::instructionDefinitions.findKey(lineTokens[mnemonicPos].lexeme.substr(0, lineTokens[mnemonicPos].lexeme.size() - 1));
+            suffix = lineTokens[0].lexeme.substr(lineTokens[0].lexeme.size() - 1);
+        }
 
-        if (lineTokens[0].type == Token::Type::Identifier) {
-            std::string mnemonicName {};
-            std::string prefix {};
-            std::string suffix {};
-            u8 mnemonicPos = 0;
+        if (!mnemonicName.empty()) {
+            // Instruction found
+            Ast::Instruction instruction;
+            Ast::Mnemonic mnemonic;
+            mnemonic.mnemonicName = mnemonicName;
 
-            auto possiblePrefixes = Interpreter::Mnemonics::populatePossiblePrefixes();
-            if (std::ranges::find(possiblePrefixes, lineTokens[0].lexeme) != possiblePrefixes.end()) {
-                prefix = lineTokens[0].lexeme;
-                mnemonicPos = 1;
+            const auto& instructionDef = *Interpreter::Mnemonics::instructionDefinitions.find(mnemonicName);
+            if (!prefix.empty()) {
+                if (std::ranges::find(instructionDef.allowedPrefixes, prefix) == instructionDef.allowedPrefixes.end()) {
+                    LOG_ERROR("Invalid prefix '{}' for mnemonic '{}' at line {} column {}", prefix, mnemonicName, lineTokens[0].line, lineTokens[0].column);
+                }
+                mnemonic.prefix = prefix;
             }
-            if (Interpreter::Mnemonics::instructionDefinitions.contains(lineTokens[mnemonicPos].lexeme)) {
-                mnemonicName = lineTokens[mnemonicPos].lexeme;
+            if (!suffix.empty()) {
+                if (std::ranges::find(instructionDef.allowedSuffixes, suffix) == instructionDef.allowedSuffixes.end()) {
+                    LOG_ERROR("Invalid suffix '{}' for mnemonic '{}' at line {} column {}", suffix, mnemonicName, lineTokens[0].line, lineTokens[0].column);
+                }
+                mnemonic.width = *suffixWidths.find(suffix);
             }
-            else if (Interpreter::Mnemonics::instructionDefinitions.contains(lineTokens[mnemonicPos].lexeme.substr(0, lineTokens[mnemonicPos].lexeme.size() - 1))) {
-                mnemonicName = lineTokens[mnemonicPos].lexeme.substr(0, lineTokens[mnemonicPos].lexeme.size() - 1);
-                suffix = lineTokens[0].lexeme.substr(lineTokens[0].lexeme.size() - 1);
+            instruction.mnemonic = mnemonic;
+            parseOperands(ast, instruction, lineTokens);
+
+            const auto* form = instructionDef.findForm(instruction.operands);
+            if (form == nullptr) {
+                LOG_ERROR("Invalid operands for mnemonic '{}' at line {} column {}", mnemonicName, lineTokens[0].line, lineTokens[0].column);
             }
+            resolveRelativeOperands(*form, instruction.operands);
+            sections.back().items.push_back(instruction);
 
-            if (!mnemonicName.empty()) {
-                // Instruction found
-                Ast::Instruction instruction;
-                Ast::Mnemonic mnemonic;
-                mnemonic.mnemonicName = mnemonicName;
+            return 0;
+        }
 
-                auto& instructionDef = Interpreter::Mnemonics::instructionDefinitions[mnemonicName];
-                if (!prefix.empty()) {
-                    if (std::ranges::find(instructionDef.allowedPrefixes, prefix) == instructionDef.allowedPrefixes.end()) {
-                        LOG_ERROR("Invalid prefix '{}' for mnemonic '{}' at line {} column {}", prefix, mnemonicName, lineTokens[0].line, lineTokens[0].column);
-                    }
-                    mnemonic.prefix = prefix;
+        else {
+            std::optional<Ast::CondCode> condCode;
+            std::string_view mnemonicName;
+
+            if (const Ast::CondCode* code = condCodes.find(lineTokens[0].lexeme.substr(1))) {
+                condCode = *code;
+                mnemonicName = "Jcc";
+            }
+            if (lineTokens[0].lexeme.size() >= 5 && lineTokens[0].lexeme.starts_with("cmov")) {
+                if (const Ast::CondCode* code = condCodes.find(lineTokens[0].lexeme.substr(4, 2))) {
+                    condCode = *code;
+                    mnemonicName = "CMOVcc";
                 }
-                if (!suffix.empty()) {
-                    if (std::ranges::find(instructionDef.allowedSuffixes, suffix) == instructionDef.allowedSuffixes.end()) {
+                if (lineTokens[0].lexeme.size() == 7) {
+                    suffix = lineTokens[0].lexeme.substr(6);
+                    const auto* instructionDef = Interpreter::Mnemonics::instructionDefinitions.find(mnemonicName);
+                    if (instructionDef == nullptr || std::ranges::find(instructionDef->allowedSuffixes, suffix) == instructionDef->allowedSuffixes.end()) {
                         LOG_ERROR("Invalid suffix '{}' for mnemonic '{}' at line {} column {}", suffix, mnemonicName, lineTokens[0].line, lineTokens[0].column);
                     }
-                    mnemonic.width = suffixWidths.at(suffix);
                 }
+            }
+            if (condCode.has_value()) {
+                Ast::Instruction instruction;
+                Ast::Mnemonic mnemonic;
+                mnemonic.mnemonicName = mnemonicName;
+                if (!suffix.empty()) {
+                    mnemonic.width = *suffixWidths.find(suffix);
+                }
+
                 instruction.mnemonic = mnemonic;
-                parseOperands(instruction, lineTokens);
+                instruction.additionalData = condCode;
+                parseOperands(ast, instruction, lineTokens);
 
-                const auto* form = findMatchingForm(instructionDef, instruction.operands);
+                const auto& instructionDef = *Interpreter::Mnemonics::instructionDefinitions.find(mnemonicName);
+                const auto* form = instructionDef.findForm(instruction.operands);
                 if (form == nullptr) {
                     LOG_ERROR("Invalid operands for mnemonic '{}' at line {} column {}", mnemonicName, lineTokens[0].line, lineTokens[0].column);
                 }
                 resolveRelativeOperands(*form, instruction.operands);
-                ast.back().items.push_back(instruction);
 
-                continue;
+                sections.back().items.push_back(instruction);
+                return 0;
             }
+        }
 
-            else {
-                std::optional<Ast::CondCode> condCode;
-                std::string mnemonicName;
+        // Labels
+        if (lineTokens[0].type == Token::Type::Identifier && lineTokens[1].type == Token::Type::Colon && lineTokens[2].type == Token::Type::EOL) {
+            if (sections.empty()) {
+                LOG_INFO("Implicit .text section created");
+                ast.addSection("text");
+            }
+            sections.back().items.push_back(Ast::Label{ ast.intern(lineTokens[0].lexeme) });
+        }
+        // Symbol assignments
+        else if (lineTokens[0].type == Token::Type::Identifier && lineTokens[1].type == Token::Type::Equal) {
+            sections.back().items.push_back(Ast::SymbolAssignment{
+                .name = ast.intern(lineTokens[0].lexeme),
+                .expression = Ast::Expression{ ast.copy(lineTokens.subspan(2, lineTokens.size() - 3)) } // Exclude EOL
+                });
+        }
+        else {
+            LOG_WARNING("Unknown mnemonic '{}' at line {} column {}", lineTokens[0].lexeme, lineTokens[0].line, lineTokens[0].column);
+        }
+    }
 
-                std::string tmp = lineTokens[0].lexeme.substr(1);
-                if (condCodeMap.contains(tmp)) {
-                    condCode = condCodeMap[tmp];
-                    mnemonicName = "Jcc";
-                }
-                if (lineTokens[0].lexeme.size() >= 5 && lineTokens[0].lexeme.starts_with("cmov")) {
-                    tmp = lineTokens[0].lexeme.substr(4, 2);
-                    if (condCodeMap.contains(tmp)) {
-                        condCode = condCodeMap[tmp];
-                        mnemonicName = "CMOVcc";
+    return 0;
+}
+
+int parse(const std::vector<Token>& tokens, Ast::Ast& ast) {
+    // every line ends in an EOL token
+    u64 lineStart = 0;
+    for (u64 i = 0; i < tokens.size(); ++i) {
+        if (tokens[i].type == Token::Type::EOL) {
+            parseLine(std::span(tokens).subspan(lineStart, i + 1 - lineStart), ast);
+            lineStart = i + 1;
+        }
+    }
+    return 0;
+}
+
+namespace {
+
+// Every chunk but the first starts in a section it cannot see, its items go into this
+// placeholder and end up in whatever section the previous chunks left open
+std::unique_ptr<Ast::Ast> parseChunk(SourceFile& source, const Chunk& chunk, const bool continuesSection) {
+    auto chunkAst = std::make_unique<Ast::Ast>();
+    if (continuesSection) {
+        chunkAst->addSection("");
+    }
+    Lexer lexer(source, chunk.begin, chunk.end, chunk.firstLine);
+    std::vector<Token> lineTokens;
+    while (lexer.nextLine(lineTokens)) {
+        parseLine(lineTokens, *chunkAst);
+        lineTokens.clear();
+    }
+    return chunkAst;
+}
+
+// Moves the items of a chunk into ast. Name IDs are translated into the pool of ast and
+// everything that lives in the arena of the chunk is copied.
+void appendChunk(Ast::Ast& ast, Ast::Ast& chunkAst, const bool continuesSection) {
+    constexpr Ast::NameId Unmapped = ~Ast::NameId{ 0 };
+    std::vector<Ast::NameId> nameMap(chunkAst.getNames().size(), Unmapped);
+    const auto mapName = [&](Ast::NameId& name) {
+        if (nameMap[name] == Unmapped) {
+            nameMap[name] = ast.intern(chunkAst.getName(name));
+        }
+        name = nameMap[name];
+    };
+    const auto mapLabel = [&](auto& target) {
+        if (std::holds_alternative<Ast::Label>(target)) {
+            mapName(std::get<Ast::Label>(target).name);
+        }
+    };
+
+    std::pmr::vector<Ast::Section>& chunkSections = chunkAst.getSections();
+    for (u64 i = 0; i < chunkSections.size(); ++i) {
+        Ast::Section& chunkSection = chunkSections[i];
+        Ast::Section* section;
+        if (i == 0 && continuesSection) {
+            if (chunkSection.items.empty()) {
+                continue;
+            }
+            if (ast.getSections().empty()) {
+                LOG_INFO("Implicit .text section created");
+                ast.addSection("text");
+            }
+            section = &ast.getSections().back();
+        }
+        else {
+            mapName(chunkSection.name);
+            section = &ast.addSection(chunkSection.name);
+        }
+
+        section->items.reserve(section->items.size() + chunkSection.items.size());
+        for (Ast::Item& item : chunkSection.items) {
+            switch (item.index()) {
+                case 0:
+                    mapName(std::get<Ast::Label>(item).name);
+                    break;
+
+                case 1:
+                    {
+                        auto& directive = std::get<Ast::Directive>(item);
+                        directive.arguments = ast.copy(directive.arguments);
+                        break;
                     }
-                    if (lineTokens[0].lexeme.size() == 7) {
-                        suffix = lineTokens[0].lexeme.substr(6);
-                        auto& instructionDef = Interpreter::Mnemonics::instructionDefinitions[mnemonicName];
-                        if (std::ranges::find(instructionDef.allowedSuffixes, suffix) == instructionDef.allowedSuffixes.end()) {
-                            LOG_ERROR("Invalid suffix '{}' for mnemonic '{}' at line {} column {}", suffix, mnemonicName, lineTokens[0].line, lineTokens[0].column);
+
+                case 2:
+                    for (Ast::Operand& operand : std::get<Ast::Instruction>(item).operands) {
+                        if (std::holds_alternative<Ast::Symbol>(operand)) {
+                            mapName(std::get<Ast::Symbol>(operand).name);
+                        }
+                        else if (std::holds_alternative<Ast::RelativeImmediate>(operand)) {
+                            mapLabel(std::get<Ast::RelativeImmediate>(operand).target);
+                        }
+                        else if (std::holds_alternative<Ast::Memory>(operand) && std::get<Ast::Memory>(operand).disp.has_value()) {
+                            mapLabel(*std::get<Ast::Memory>(operand).disp);
                         }
                     }
-                }
-                if (condCode.has_value()) {
-                    Ast::Instruction instruction;
-                    Ast::Mnemonic mnemonic;
-                    mnemonic.mnemonicName = mnemonicName;
-                    if (!suffix.empty()) {
-                        mnemonic.width = suffixWidths.at(suffix);
+                    break;
+
+                case 3:
+                    {
+                        auto& symbolAssignment = std::get<Ast::SymbolAssignment>(item);
+                        mapName(symbolAssignment.name);
+                        symbolAssignment.expression.tokens = ast.copy(symbolAssignment.expression.tokens);
+                        break;
                     }
+            }
+            section->items.push_back(item);
+        }
+    }
+}
+
+// Line numbers have to be known before lexing, error messages point at them
+void countLines(const std::string_view text, std::vector<Chunk>& chunks, ThreadPool& pool) {
+    std::vector<std::future<u64>> lineCounts;
+    for (const Chunk& chunk : chunks) {
+        lineCounts.push_back(pool.submit([text, chunk] {
+            return static_cast<u64>(std::count(text.begin() + chunk.begin, text.begin() + chunk.end, '\n'));
+        }));
+    }
+    u32 line = 0;
+    for (u64 i = 0; i < chunks.size(); ++i) {
+        chunks[i].firstLine = line;
+        line += static_cast<u32>(lineCounts[i].get());
+    }
+}
 
-                    instruction.mnemonic = mnemonic;
-                    instruction.additionalData = condCode;
-                    parseOperands(instruction, lineTokens);
+// Labels at the start of a line are taken as the start of a function, local labels start with '.'
+bool startsRegion(std::string_view line) {
+    const u64 indent = line.find_first_not_of(" \t");
+    if (indent == std::string_view::npos) {
+        return false;
+    }
+    line.remove_prefix(indent);
+    if (line.starts_with(".section") || line.starts_with(".text") || line.starts_with(".data") || line.starts_with(".bss")) {
+        return true;
+    }
+    if (indent != 0 || !(std::isalpha(static_cast<unsigned char>(line[0])) || line[0] == '_')) {
+        return false;
+    }
+    const u64 nameEnd = line.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_.$");
+    return nameEnd != std::string_view::npos && line[nameEnd] == ':';
+}
 
-                    auto& instructionDef = Interpreter::Mnemonics::instructionDefinitions[mnemonicName];
-                    const auto* form = findMatchingForm(instructionDef, instruction.operands);
-                    if (form == nullptr) {
-                        LOG_ERROR("Invalid operands for mnemonic '{}' at line {} column {}", mnemonicName, lineTokens[0].line, lineTokens[0].column);
-                    }
-                    resolveRelativeOperands(*form, instruction.operands);
+// FNV-1a over the window, only has to spread well enough to pick one in RegionBoundaryRate candidates
+bool isRegionBoundary(const std::string_view window) {
+    u64 hash = 0xcbf29ce484222325ull;
+    for (const char c : window) {
+        hash = (hash ^ static_cast<u8>(c)) * 0x100000001b3ull;
+    }
+    return (hash ^ (hash >> 32)) % RegionBoundaryRate == 0;
+}
 
-                    ast.back().items.push_back(instruction);
-                    continue;
-                }
-            }
+} // namespace
 
-            // Labels
-            if (lineTokens[0].type == Token::Type::Identifier && lineTokens[1].type == Token::Type::Colon && lineTokens[2].type == Token::Type::EOL) {
-                if (ast.empty()) {
-                    LOG_INFO("Implicit .text section created");
-                    ast.push_back(Ast::Section{ "text", {} });
-                }
-                ast.back().items.push_back(Ast::Label{ lineTokens[0].lexeme });
-            }
-            // Symbol assignments
-            else if (lineTokens[0].type == Token::Type::Identifier && lineTokens[1].type == Token::Type::Equal) {
-                ast.back().items.push_back(Ast::SymbolAssignment{
-                    .name = lineTokens[0].lexeme,
-                    .expression = Ast::Expression{ std::vector<Token>{ lineTokens.begin() + 2, lineTokens.end() - 1 } } // Exclude EOL
-                    });
-            }
-            else {
-                LOG_WARNING("Unknown mnemonic '{}' at line {} column {}", lineTokens[0].lexeme, lineTokens[0].line, lineTokens[0].column);
-            }
+int parseParallel(SourceFile& source, Ast::Ast& ast, ThreadPool& pool) {
+    const std::string_view text = source.getText();
+
+    std::vector<Chunk> chunks;
+    for (u64 begin = 0; begin < text.size();) {
+        u64 end = std::min(begin + ParallelChunkSize, text.size());
+        if (end < text.size()) {
+            end = std::min(text.find('\n', end), text.size() - 1) + 1;
         }
+        chunks.push_back(Chunk{ begin, end, 0 });
+        begin = end;
     }
+    countLines(text, chunks, pool);
 
+    std::vector<std::future<std::unique_ptr<Ast::Ast>>> parsedChunks;
+    for (u64 i = 0; i < chunks.size(); ++i) {
+        parsedChunks.push_back(pool.submit([&source, chunk = chunks[i], i] {
+            return parseChunk(source, chunk, i != 0);
+        }));
+    }
+    // stitched in order while the later chunks are still being parsed
+    for (u64 i = 0; i < parsedChunks.size(); ++i) {
+        appendChunk(ast, *parsedChunks[i].get(), i != 0);
+    }
     return 0;
+}
 
+int parseIncremental(SourceFile& source, Ast::Ast& ast, ThreadPool& pool, const std::filesystem::path& cacheDirectory) {
+    const std::string_view text = source.getText();
+
+    // Whether a line is a boundary only depends on the line and the text right after it, not on where the
+    // previous region started. An edit therefore only changes the regions around it, the boundaries after
+    // it stay on the same lines unless the min or max size forces a different cut nearby.
+    std::vector<Chunk> regions;
+    u64 begin = 0;
+    for (u64 lineStart = 0; lineStart < text.size();) {
+        const u64 lineEnd = std::min(text.find('\n', lineStart), text.size());
+        const u64 size = lineStart - begin;
+        if (size >= RegionMaxSize
+            || (size >= RegionMinSize && startsRegion(text.substr(lineStart, lineEnd - lineStart)) && isRegionBoundary(text.substr(lineStart, RegionBoundaryWindow)))) {
+            regions.push_back(Chunk{ begin, lineStart, 0 });
+            begin = lineStart;
+        }
+        lineStart = lineEnd + 1;
+    }
+    if (begin < text.size() || regions.empty()) {
+        regions.push_back(Chunk{ begin, text.size(), 0 });
+    }
+    countLines(text, regions, pool);
+
+    const RegionCache cache(cacheDirectory);
+    std::vector<std::future<std::pair<std::unique_ptr<Ast::Ast>, bool>>> parsedRegions;
+    for (u64 i = 0; i < regions.size(); ++i) {
+        parsedRegions.push_back(pool.submit([&source, &cache, region = regions[i], i] {
+            if (auto regionAst = cache.load(source, region, i != 0)) {
+                return std::make_pair(std::move(regionAst), true);
+            }
+            auto regionAst = parseChunk(source, region, i != 0);
+            cache.store(source, region, i != 0, *regionAst);
+            return std::make_pair(std::move(regionAst), false);
+        }));
+    }
+    u64 cachedCount = 0;
+    for (u64 i = 0; i < parsedRegions.size(); ++i) {
+        auto [regionAst, cached] = parsedRegions[i].get();
+        appendChunk(ast, *regionAst, i != 0);
+        cachedCount += cached;
+    }
+    LOG_DEBUG("{} of {} regions read from the parse cache, {} parsed.", cachedCount, regions.size(), regions.size() - cachedCount);
+    return 0;
+}
+
+std::vector<std::unique_ptr<Ast::Ast>> parseFiles(const std::span<SourceFile> sources, ThreadPool& pool, const std::optional<std::filesystem::path>& cacheDirectory) {
+    std::optional<RegionCache> cache;
+    if (cacheDirectory.has_value()) {
+        cache.emplace(*cacheDirectory);
+    }
+
+    std::vector<std::future<std::pair<std::unique_ptr<Ast::Ast>, bool>>> parsedFiles;
+    for (SourceFile& source : sources) {
+        parsedFiles.push_back(pool.submit([&source, &cache] {
+            const Chunk file{ 0, source.getText().size(), 0 };
+            if (cache.has_value()) {
+                if (auto fileAst = cache->load(source, file, false)) {
+                    return std::make_pair(std::move(fileAst), true);
+                }
+            }
+            auto fileAst = parseChunk(source, file, false);
+            if (cache.has_value()) {
+                cache->store(source, file, false, *fileAst);
+            }
+            return std::make_pair(std::move(fileAst), false);
+        }));
+    }
+    std::vector<std::unique_ptr<Ast::Ast>> asts;
+    u64 cachedCount = 0;
+    for (auto& parsedFile : parsedFiles) {
+        auto [fileAst, cached] = parsedFile.get();
+        asts.push_back(std::move(fileAst));
+        cachedCount += cached;
+    }
+    if (cache.has_value()) {
+        LOG_DEBUG("{} of {} files read from the parse cache, {} parsed.", cachedCount, sources.size(), sources.size() - cachedCount);
+    }
+    return asts;
 }
 
-} // namespace Parser
\ No newline at end of file
+} // namespace Parser
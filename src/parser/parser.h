@@ -3,9 +3,16 @@
 
 #pragma once
 
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "perfect_hash.h"
+#include "thread_pool.h"
 #include "types.h"
 #include "lexer/lexer.h"
 
@@ -23,14 +30,14 @@ enum class IgnoredDirectives {
     file,
 };
 
-inline const std::unordered_map<std::string, Ast::Width> suffixWidths = {
+inline constexpr auto suffixWidths = makePerfectHashTable<Ast::Width>({
     {"b", Ast::Width::Byte},
     {"w", Ast::Width::Word},
     {"l", Ast::Width::Long},
     {"q", Ast::Width::Quad},
-};
+});
 
-inline std::unordered_map<std::string, Ast::CondCode> condCodeMap = {
+inline constexpr auto condCodes = makePerfectHashTable<Ast::CondCode>({
     {"o", Ast::CondCode::overflow},
     {"no", Ast::CondCode::notOverflow},
     {"s", Ast::CondCode::sign},
@@ -61,86 +68,148 @@ inline std::unordered_map<std::string, Ast::CondCode> condCodeMap = {
     {"pe", Ast::CondCode::parityEven},
     {"np", Ast::CondCode::notParity},
     {"po", Ast::CondCode::parityOdd},
+});
+
+struct RegisterInfo {
+    Ast::Width width;
+    u8 index;
 };
 
-inline std::unordered_map<std::string, Ast::Register> registerTable = {
-    { "rax", { "rax", Ast::Width::Quad, 0 }},
-    { "rbx", { "rbx", Ast::Width::Quad, 1 }},
-    { "rcx", { "rcx", Ast::Width::Quad, 2 }},
-    { "rdx", { "rdx", Ast::Width::Quad, 3 }},
-    { "rsi", { "rsi", Ast::Width::Quad, 4 }},
-    { "rdi", { "rdi", Ast::Width::Quad, 5 }},
-    { "rsp", { "rsp", Ast::Width::Quad, 6 }},
-    { "rbp", { "rbp", Ast::Width::Quad, 7 }},
-    { "r8", { "r8", Ast::Width::Quad, 8 }},
-    { "r9", { "r9", Ast::Width::Quad, 9 }},
-    { "r10", { "r10", Ast::Width::Quad, 10 }},
-    { "r11", { "r11", Ast::Width::Quad, 11 }},
-    { "r12", { "r12", Ast::Width::Quad, 12 }},
-    { "r13", { "r13", Ast::Width::Quad, 13 }},
-    { "r14", { "r14", Ast::Width::Quad, 14 }},
-    { "r15", { "r15", Ast::Width::Quad, 15 }},
-    { "rip", { "rip", Ast::Width::Quad, 16 }},
-    { "eax", { "eax", Ast::Width::Long, 0 }},
-    { "ebx", { "ebx", Ast::Width::Long, 1 }},
-    { "ecx", { "ecx", Ast::Width::Long, 2 }},
-    { "edx", { "edx", Ast::Width::Long, 3 }},
-    { "esi", { "esi", Ast::Width::Long, 4 }},
-    { "edi", { "edi", Ast::Width::Long, 5 }},
-    { "esp", { "esp", Ast::Width::Long, 6 }},
-    { "ebp", { "ebp", Ast::Width::Long, 7 }},
-    { "r8d", { "r8d", Ast::Width::Long, 8 }},
-    { "r9d", { "r9d", Ast::Width::Long, 9 }},
-    { "r10d", { "r10d", Ast::Width::Long, 10 }},
-    { "r11d", { "r11d", Ast::Width::Long, 11 }},
-    { "r12d", { "r12d", Ast::Width::Long, 12 }},
-    { "r13d", { "r13d", Ast::Width::Long, 13 }},
-    { "r14d", { "r14d", Ast::Width::Long, 14 }},
-    { "r15d", { "r15d", Ast::Width::Long, 15 }},
-    { "eip", { "eip", Ast::Width::Long, 16 }},
-    { "ax", { "ax", Ast::Width::Word, 0 }},
-    { "bx", { "bx", Ast::Width::Word, 1 }},
-    { "cx", { "cx", Ast::Width::Word, 2 }},
-    { "dx", { "dx", Ast::Width::Word, 3 }},
-    { "si", { "si", Ast::Width::Word, 4 }},
-    { "di", { "di", Ast::Width::Word, 5 }},
-    { "sp", { "sp", Ast::Width::Word, 6 }},
-    { "bp", { "bp", Ast::Width::Word, 7 }},
-    { "r8w", { "r8w", Ast::Width::Word, 8 }},
-    { "r9w", { "r9w", Ast::Width::Word, 9 }},
-    { "r10w", { "r10w", Ast::Width::Word, 10 }},
-    { "r11w", { "r11w", Ast::Width::Word, 11 }},
-    { "r12w", { "r12w", Ast::Width::Word, 12 }},
-    { "r13w", { "r13w", Ast::Width::Word, 13 }},
-    { "r14w", { "r14w", Ast::Width::Word, 14 }},
-    { "r15w", { "r15w", Ast::Width::Word, 15 }},
-    { "ip", { "ip", Ast::Width::Word, 16 }},
-    { "ah", { "ah", Ast::Width::Byte, 0 }},
-    { "bh", { "bh", Ast::Width::Byte, 1 }},
-    { "ch", { "ch", Ast::Width::Byte, 2 }},
-    { "dh", { "dh", Ast::Width::Byte, 3 }},
-    { "al", { "al", Ast::Width::Byte, 4 }},
-    { "bl", { "bl", Ast::Width::Byte, 5 }},
-    { "cl", { "cl", Ast::Width::Byte, 6 }},
-    { "dl", { "dl", Ast::Width::Byte, 7 }},
-    { "sil", { "sil", Ast::Width::Byte, 8 }},
-    { "dil", { "dil", Ast::Width::Byte, 9 }},
-    { "spl", { "spl", Ast::Width::Byte, 10 }},
-    { "bpl", { "bpl", Ast::Width::Byte, 11 }},
-    { "r8b", { "r8b", Ast::Width::Byte, 12 }},
-    { "r9b", { "r9b", Ast::Width::Byte, 13 }},
-    { "r10b", { "r10b", Ast::Width::Byte, 14 }},
-    { "r11b", { "r11b", Ast::Width::Byte, 15 }},
-    { "r12b", { "r12b", Ast::Width::Byte, 16 }},
-    { "r13b", { "r13b", Ast::Width::Byte, 17 }},
-    { "r14b", { "r14b", Ast::Width::Byte, 18 }},
-    { "r15b", { "r15b", Ast::Width::Byte, 19 }}
+inline constexpr auto registerTable = makePerfectHashTable<RegisterInfo>({
+    { "rax", { Ast::Width::Quad, 0 }},
+    { "rbx", { Ast::Width::Quad, 1 }},
+    { "rcx", { Ast::Width::Quad, 2 }},
+    { "rdx", { Ast::Width::Quad, 3 }},
+    { "rsi", { Ast::Width::Quad, 4 }},
+    { "rdi", { Ast::Width::Quad, 5 }},
+    { "rsp", { Ast::Width::Quad, 6 }},
+    { "rbp", { Ast::Width::Quad, 7 }},
+    { "r8", { Ast::Width::Quad, 8 }},
+    { "r9", { Ast::Width::Quad, 9 }},
+    { "r10", { Ast::Width::Quad, 10 }},
+    { "r11", { Ast::Width::Quad, 11 }},
+    { "r12", { Ast::Width::Quad, 12 }},
+    { "r13", { Ast::Width::Quad, 13 }},
+    { "r14", { Ast::Width::Quad, 14 }},
+    { "r15", { Ast::Width::Quad, 15 }},
+    { "rip", { Ast::Width::Quad, 16 }},
+    { "eax", { Ast::Width::Long, 0 }},
+    { "ebx", { Ast::Width::Long, 1 }},
+    { "ecx", { Ast::Width::Long, 2 }},
+    { "edx", { Ast::Width::Long, 3 }},
+    { "esi", { Ast::Width::Long, 4 }},
+    { "edi", { Ast::Width::Long, 5 }},
+    { "esp", { Ast::Width::Long, 6 }},
+    { "ebp", { Ast::Width::Long, 7 }},
+    { "r8d", { Ast::Width::Long, 8 }},
+    { "r9d", { Ast::Width::Long, 9 }},
+    { "r10d", { Ast::Width::Long, 10 }},
+    { "r11d", { Ast::Width::Long, 11 }},
+    { "r12d", { Ast::Width::Long, 12 }},
+    { "r13d", { Ast::Width::Long, 13 }},
+    { "r14d", { Ast::Width::Long, 14 }},
+    { "r15d", { Ast::Width::Long, 15 }},
+    { "eip", { Ast::Width::Long, 16 }},
+    { "ax", { Ast::Width::Word, 0 }},
+    { "bx", { Ast::Width::Word, 1 }},
+    { "cx", { Ast::Width::Word, 2 }},
+    { "dx", { Ast::Width::Word, 3 }},
+    { "si", { Ast::Width::Word, 4 }},
+    { "di", { Ast::Width::Word, 5 }},
+    { "sp", { Ast::Width::Word, 6 }},
+    { "bp", { Ast::Width::Word, 7 }},
+    { "r8w", { Ast::Width::Word, 8 }},
+    { "r9w", { Ast::Width::Word, 9 }},
+    { "r10w", { Ast::Width::Word, 10 }},
+    { "r11w", { Ast::Width::Word, 11 }},
+    { "r12w", { Ast::Width::Word, 12 }},
+    { "r13w", { Ast::Width::Word, 13 }},
+    { "r14w", { Ast::Width::Word, 14 }},
+    { "r15w", { Ast::Width::Word, 15 }},
+    { "ip", { Ast::Width::Word, 16 }},
+    { "ah", { Ast::Width::Byte, 0 }},
+    { "bh", { Ast::Width::Byte, 1 }},
+    { "ch", { Ast::Width::Byte, 2 }},
+    { "dh", { Ast::Width::Byte, 3 }},
+    { "al", { Ast::Width::Byte, 4 }},
+    { "bl", { Ast::Width::Byte, 5 }},
+    { "cl", { Ast::Width::Byte, 6 }},
+    { "dl", { Ast::Width::Byte, 7 }},
+    { "sil", { Ast::Width::Byte, 8 }},
+    { "dil", { Ast::Width::Byte, 9 }},
+    { "spl", { Ast::Width::Byte, 10 }},
+    { "bpl", { Ast::Width::Byte, 11 }},
+    { "r8b", { Ast::Width::Byte, 12 }},
+    { "r9b", { Ast::Width::Byte, 13 }},
+    { "r10b", { Ast::Width::Byte, 14 }},
+    { "r11b", { Ast::Width::Byte, 15 }},
+    { "r12b", { Ast::Width::Byte, 16 }},
+    { "r13b", { Ast::Width::Byte, 17 }},
+    { "r14b", { Ast::Width::Byte, 18 }},
+    { "r15b", { Ast::Width::Byte, 19 }},
+});
+
+inline constexpr auto directiveNames = makePerfectHashTable<Ast::Directive::Name>({
+    {"global", Ast::Directive::Name::global},
+    {"globl", Ast::Directive::Name::globl},
+    {"ascii", Ast::Directive::Name::ascii},
+    {"asciz", Ast::Directive::Name::asciz},
+    {"quad", Ast::Directive::Name::quad},
+    {"byte", Ast::Directive::Name::byte},
+    {"skip", Ast::Directive::Name::skip},
+    {"space", Ast::Directive::Name::space},
+    {"zero", Ast::Directive::Name::zero},
+});
+
+inline constexpr auto ignoredDirectives = makePerfectHashTable<IgnoredDirectives>({
+    {"type", IgnoredDirectives::type},
+    {"cfi_startproc", IgnoredDirectives::cfi_startproc},
+    {"cfi_endproc", IgnoredDirectives::cfi_endproc},
+    {"cfi_undefined", IgnoredDirectives::cfi_undefined},
+    {"size", IgnoredDirectives::size},
+    {"file", IgnoredDirectives::file},
+});
+
+// The AST register for a name without the '%', nullopt if there is no such register
+std::optional<Ast::Register> findRegister(std::string_view name);
+// Whether width and index describe a register of registerTable, for registers read back from a file
+bool isRegister(u8 width, u8 index);
+
+bool isNumber(std::string_view text);
+bool isHexNumber(std::string_view text);
+s64 textToNumber(std::string_view text);
+int parseOperand(Ast::Ast& ast, Ast::Instruction& instruction, std::span<const Token> lineTokens, u32 operandStart, const std::vector<u32>& operandCommaPositions);
+// Parses the tokens of one line including its EOL, new sections and items are appended to ast
+int parseLine(std::span<const Token> lineTokens, Ast::Ast& ast);
+int parse(const std::vector<Token>& tokens, Ast::Ast& ast);
+
+// Source files at most this large are lexed and parsed as a single chunk
+inline constexpr u64 ParallelChunkSize = 1024 * 1024;
+
+// Regions cached by parseIncremental end before a function label or section directive whose text hashes to a
+// boundary, one in RegionBoundaryRate of them on average. Regions are cut at any line once they reach the max size.
+inline constexpr u64 RegionMinSize = 16 * 1024;
+inline constexpr u64 RegionMaxSize = 256 * 1024;
+inline constexpr u64 RegionBoundaryRate = 64;
+// bytes from the start of a candidate line that decide whether it is a boundary
+inline constexpr u64 RegionBoundaryWindow = 64;
+
+// Line aligned part of a source file that is lexed and parsed on its own
+struct Chunk {
+    u64 begin;
+    u64 end;
+    u32 firstLine;
 };
 
-bool isNumber(const std::string& text);
-bool isHexNumber(const std::string& text);
-s64 textToNumber(const std::string& text);
-int parseOperand(const Ast::Instruction& instruction, const std::vector<Token>& lineTokens, u32 operandStart, const std::vector<u32>& operandCommaPositions);
-int parse(const std::vector<Token>& tokens, std::vector<Ast::Section>& ast);
+// Lexes and parses the source in line aligned chunks on the pool and appends the results to ast in source order
+int parseParallel(SourceFile& source, Ast::Ast& ast, ThreadPool& pool);
+
+// Like parseParallel, but regions whose text is found in the cache directory are read back instead of parsed
+// and new ones are added to it. Editing one function of a large file only parses the region around it again.
+int parseIncremental(SourceFile& source, Ast::Ast& ast, ThreadPool& pool, const std::filesystem::path& cacheDirectory);
+
+// Parses every source on its own on the pool, one AST per source in the same order. With a cache directory
+// each file is a single entry keyed by the hash of its text, so only files that changed are parsed again.
+std::vector<std::unique_ptr<Ast::Ast>> parseFiles(std::span<SourceFile> sources, ThreadPool& pool, const std::optional<std::filesystem::path>& cacheDirectory);
 
 } // namespace Parser
\ No newline at end of file
@@ -0,0 +1,527 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+#include <magic_enum/magic_enum.hpp>
+
+#include "logging.h"
+#include "interpreter/mnemonics.h"
+
+#include "region_cache.h"
+
+namespace Parser
+{
+
+namespace {
+
+constexpr char Magic[8] = { 'A', 'C', 'P', 'A', 'R', 'S', 'E', '\0' };
+// bump whenever the AST or the way it is written changes
+constexpr u32 FormatVersion = 2;
+
+enum class LexemeKind : u8 {
+    Source, // offset into the text of the region
+    Inline, // stored in the entry, the lexer had to copy it
+};
+
+// 64 bit words at a time, entries are verified against the text so it only has to spread well
+u64 hashText(const std::string_view text) {
+    u64 hash = 0xcbf29ce484222325ull ^ text.size();
+    u64 position = 0;
+    for (; position + sizeof(u64) <= text.size(); position += sizeof(u64)) {
+        u64 word;
+        std::memcpy(&word, text.data() + position, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ull;
+        hash ^= hash >> 29;
+    }
+    for (; position < text.size(); ++position) {
+        hash = (hash ^ static_cast<u8>(text[position])) * 0x100000001b3ull;
+    }
+    return hash ^ (hash >> 32);
+}
+
+class Writer {
+    public:
+        explicit Writer(const std::string_view regionText) : regionText(regionText) {}
+
+        template <typename T>
+        void put(const T value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void putString(const std::string_view text) {
+            put<u32>(static_cast<u32>(text.size()));
+            data.append(text);
+        }
+
+        void putLexeme(const std::string_view lexeme) {
+            if (lexeme.data() >= regionText.data() && lexeme.data() + lexeme.size() <= regionText.data() + regionText.size()) {
+                put(LexemeKind::Source);
+                put<u64>(static_cast<u64>(lexeme.data() - regionText.data()));
+                put<u32>(static_cast<u32>(lexeme.size()));
+            }
+            else {
+                put(LexemeKind::Inline);
+                putString(lexeme);
+            }
+        }
+
+        const std::string& getData() const {
+            return data;
+        }
+
+    private:
+        std::string_view regionText;
+        std::string data;
+};
+
+// Every read is bounds checked, a truncated or foreign entry sets failed instead of reading garbage
+class Reader {
+    public:
+        Reader(const std::string_view data, SourceFile& source, const std::string_view regionText)
+            : data(data), source(source), regionText(regionText) {}
+
+        template <typename T>
+        T get() {
+            static_assert(std::is_trivially_copyable_v<T>);
+            T value{};
+            if (position + sizeof(T) > data.size()) {
+                failed = true;
+                return value;
+            }
+            std::memcpy(&value, data.data() + position, sizeof(T));
+            position += sizeof(T);
+            return value;
+        }
+
+        std::string_view getString() {
+            const u32 size = get<u32>();
+            if (failed || position + size > data.size()) {
+                failed = true;
+                return {};
+            }
+            const std::string_view text = data.substr(position, size);
+            position += size;
+            return text;
+        }
+
+        std::string_view getLexeme() {
+            if (get<LexemeKind>() == LexemeKind::Source) {
+                const u64 offset = get<u64>();
+                const u32 size = get<u32>();
+                if (failed || offset + size > regionText.size()) {
+                    failed = true;
+                    return {};
+                }
+                return regionText.substr(offset, size);
+            }
+            const std::string_view text = getString();
+            return failed ? std::string_view{} : source.keep(text);
+        }
+
+        // IDs past the names of the entry would index out of bounds when the region is appended
+        Ast::NameId getName() {
+            const Ast::NameId name = get<Ast::NameId>();
+            failed = failed || name >= nameCount;
+            return name;
+        }
+
+        // values the enum does not have would fall through the switches that handle it
+        template <typename E>
+        E getEnum() {
+            const u8 value = get<u8>();
+            failed = failed || !magic_enum::enum_contains<E>(value);
+            return static_cast<E>(value);
+        }
+
+        void check(const bool valid) {
+            failed = failed || !valid;
+        }
+
+        void setNameCount(const u32 count) {
+            nameCount = count;
+        }
+
+        // a corrupt count must not turn into a huge allocation, every element takes at least a byte
+        bool canHold(const u64 count) const {
+            return !failed && count <= data.size() - position;
+        }
+
+        bool hasFailed() const {
+            return failed;
+        }
+
+        bool isAtEnd() const {
+            return position == data.size();
+        }
+
+    private:
+        std::string_view data;
+        SourceFile& source;
+        std::string_view regionText;
+        u64 position = 0;
+        u32 nameCount = 0;
+        bool failed = false;
+};
+
+void putTarget(Writer& writer, const std::variant<s64, Ast::Label>& target) {
+    writer.put<u8>(static_cast<u8>(target.index()));
+    if (std::holds_alternative<s64>(target)) {
+        writer.put<s64>(std::get<s64>(target));
+    }
+    else {
+        writer.put<Ast::NameId>(std::get<Ast::Label>(target).name);
+    }
+}
+
+std::variant<s64, Ast::Label> getTarget(Reader& reader) {
+    const u8 alternative = reader.get<u8>();
+    reader.check(alternative <= 1);
+    if (alternative == 0) {
+        return reader.get<s64>();
+    }
+    return Ast::Label{ reader.getName() };
+}
+
+void putRegister(Writer& writer, const Ast::Register& reg) {
+    writer.put<u8>(static_cast<u8>(reg.width));
+    writer.put<u8>(reg.index);
+}
+
+Ast::Register getRegister(Reader& reader) {
+    const u8 width = reader.get<u8>();
+    const u8 index = reader.get<u8>();
+    reader.check(isRegister(width, index));
+    return Ast::Register{ static_cast<Ast::Width>(width), index };
+}
+
+void putOperand(Writer& writer, const Ast::Operand& operand) {
+    writer.put<u8>(static_cast<u8>(operand.index()));
+    switch (static_cast<Ast::OperandType>(operand.index())) {
+        case Ast::OperandType::Register:
+            putRegister(writer, std::get<Ast::Register>(operand));
+            break;
+
+        case Ast::OperandType::RelativeImmediate:
+            putTarget(writer, std::get<Ast::RelativeImmediate>(operand).target);
+            break;
+
+        case Ast::OperandType::Immediate:
+            writer.put<u64>(std::get<Ast::Immediate>(operand).value);
+            break;
+
+        case Ast::OperandType::Memory:
+            {
+                const auto& memory = std::get<Ast::Memory>(operand);
+                writer.put<u8>(memory.disp.has_value() | memory.base.has_value() << 1 | memory.index.has_value() << 2 | memory.scale.has_value() << 3);
+                if (memory.disp.has_value()) {
+                    putTarget(writer, *memory.disp);
+                }
+                if (memory.base.has_value()) {
+                    putRegister(writer, *memory.base);
+                }
+                if (memory.index.has_value()) {
+                    putRegister(writer, *memory.index);
+                }
+                if (memory.scale.has_value()) {
+                    writer.put<u8>(static_cast<u8>(*memory.scale));
+                }
+                break;
+            }
+
+        case Ast::OperandType::Symbol:
+            writer.put<Ast::NameId>(std::get<Ast::Symbol>(operand).name);
+            break;
+    }
+}
+
+Ast::Operand getOperand(Reader& reader) {
+    switch (static_cast<Ast::OperandType>(reader.get<u8>())) {
+        case Ast::OperandType::Register:
+            return getRegister(reader);
+
+        case Ast::OperandType::RelativeImmediate:
+            return Ast::RelativeImmediate{ getTarget(reader) };
+
+        case Ast::OperandType::Immediate:
+            return Ast::Immediate{ reader.get<u64>() };
+
+        case Ast::OperandType::Memory:
+            {
+                const u8 present = reader.get<u8>();
+                reader.check(present < 16);
+                Ast::Memory memory;
+                if (present & 1) {
+                    memory.disp = getTarget(reader);
+                }
+                if (present & 2) {
+                    memory.base = getRegister(reader);
+                }
+                if (present & 4) {
+                    memory.index = getRegister(reader);
+                }
+                if (present & 8) {
+                    memory.scale = reader.getEnum<Ast::Scale>();
+                }
+                return memory;
+            }
+
+        case Ast::OperandType::Symbol:
+            return Ast::Symbol{ reader.getName() };
+    }
+    reader.check(false);
+    return Ast::Immediate{ 0 };
+}
+
+void putInstruction(Writer& writer, const Ast::Instruction& instruction) {
+    writer.putString(instruction.mnemonic.mnemonicName);
+    writer.putString(instruction.mnemonic.prefix);
+    writer.put<u8>(instruction.mnemonic.width.has_value() ? static_cast<u8>(*instruction.mnemonic.width) : 0);
+    writer.put<u8>(instruction.additionalData.has_value() ? static_cast<u8>(std::get<Ast::CondCode>(*instruction.additionalData)) + 1 : 0);
+    writer.put<u8>(static_cast<u8>(instruction.operands.size()));
+    for (const Ast::Operand& operand : instruction.operands) {
+        putOperand(writer, operand);
+    }
+}
+
+bool getInstruction(Reader& reader, Ast::Instruction& instruction) {
+    // the AST points at the keys of the static tables, not at the entry
+    instruction.mnemonic.mnemonicName = Interpreter::Mnemonics::instructionDefinitions.findKey(reader.getString());
+    const std::string_view prefix = reader.getString();
+    if (instruction.mnemonic.mnemonicName.empty()) {
+        return false;
+    }
+    if (!prefix.empty()) {
+        instruction.mnemonic.prefix = Interpreter::Mnemonics::instructionPrefixes.findKey(prefix);
+        if (instruction.mnemonic.prefix.empty()) {
+            return false;
+        }
+    }
+    if (const u8 width = reader.get<u8>(); width != 0) {
+        if (!magic_enum::enum_contains<Ast::Width>(width)) {
+            return false;
+        }
+        instruction.mnemonic.width = static_cast<Ast::Width>(width);
+    }
+    if (const u8 condCode = reader.get<u8>(); condCode != 0) {
+        if (!magic_enum::enum_contains<Ast::CondCode>(condCode - 1)) {
+            return false;
+        }
+        instruction.additionalData = static_cast<Ast::CondCode>(condCode - 1);
+    }
+    const u8 operandCount = reader.get<u8>();
+    if (operandCount > 2) {
+        return false;
+    }
+    for (u8 i = 0; i < operandCount; ++i) {
+        instruction.operands.push_back(getOperand(reader));
+    }
+    return true;
+}
+
+void putItem(Writer& writer, const Ast::Item& item, const u32 firstLine) {
+    writer.put<u8>(static_cast<u8>(item.index()));
+    switch (item.index()) {
+        case 0:
+            writer.put<Ast::NameId>(std::get<Ast::Label>(item).name);
+            break;
+
+        case 1:
+            {
+                const auto& directive = std::get<Ast::Directive>(item);
+                writer.put<u8>(static_cast<u8>(directive.name));
+                writer.put<u32>(static_cast<u32>(directive.arguments.size()));
+                for (const std::string_view argument : directive.arguments) {
+                    writer.putLexeme(argument);
+                }
+                break;
+            }
+
+        case 2:
+            putInstruction(writer, std::get<Ast::Instruction>(item));
+            break;
+
+        case 3:
+            {
+                const auto& symbolAssignment = std::get<Ast::SymbolAssignment>(item);
+                writer.put<Ast::NameId>(symbolAssignment.name);
+                writer.put<u32>(static_cast<u32>(symbolAssignment.expression.tokens.size()));
+                for (const Token& token : symbolAssignment.expression.tokens) {
+                    writer.put<u8>(static_cast<u8>(token.type));
+                    writer.putLexeme(token.lexeme);
+                    writer.put<u32>(token.line - firstLine);
+                    writer.put<u32>(token.column);
+                    writer.put<u32>(token.length);
+                }
+                break;
+            }
+    }
+}
+
+bool getItem(Reader& reader, Ast::Ast& ast, Ast::Section& section, const u32 firstLine) {
+    switch (reader.get<u8>()) {
+        case 0:
+            section.items.push_back(Ast::Label{ reader.getName() });
+            return true;
+
+        case 1:
+            {
+                Ast::Directive directive;
+                directive.name = reader.getEnum<Ast::Directive::Name>();
+                const u32 argumentCount = reader.get<u32>();
+                if (!reader.canHold(argumentCount)) {
+                    return false;
+                }
+                std::span<std::string_view> arguments = ast.allocate<std::string_view>(argumentCount);
+                for (std::string_view& argument : arguments) {
+                    argument = reader.getLexeme();
+                }
+                directive.arguments = arguments;
+                section.items.push_back(directive);
+                return true;
+            }
+
+        case 2:
+            {
+                Ast::Instruction instruction{};
+                if (!getInstruction(reader, instruction)) {
+                    return false;
+                }
+                section.items.push_back(instruction);
+                return true;
+            }
+
+        case 3:
+            {
+                const Ast::NameId name = reader.getName();
+                const u32 tokenCount = reader.get<u32>();
+                if (!reader.canHold(tokenCount)) {
+                    return false;
+                }
+                std::span<Token> tokens = ast.allocate<Token>(tokenCount);
+                for (Token& token : tokens) {
+                    token.type = reader.getEnum<Token::Type>();
+                    token.lexeme = reader.getLexeme();
+                    token.line = reader.get<u32>() + firstLine;
+                    token.column = reader.get<u32>();
+                    token.length = reader.get<u32>();
+                }
+                section.items.push_back(Ast::SymbolAssignment{ name, Ast::Expression{ tokens } });
+                return true;
+            }
+    }
+    return false;
+}
+
+} // namespace
+
+std::filesystem::path RegionCache::getEntryPath(const std::string_view text, const bool continuesSection) const {
+    return directory / std::format("{:016x}{}.acparse", hashText(text), continuesSection ? "" : "-first");
+}
+
+std::unique_ptr<Ast::Ast> RegionCache::load(SourceFile& source, const Chunk& chunk, const bool continuesSection) const {
+    const std::string_view regionText = source.getText().substr(chunk.begin, chunk.end - chunk.begin);
+    std::ifstream in(getEntryPath(regionText, continuesSection), std::ios::binary | std::ios::ate);
+    if (!in) {
+        return nullptr;
+    }
+    std::string entry(static_cast<u64>(in.tellg()), '\0');
+    in.seekg(0);
+    if (!in.read(entry.data(), static_cast<std::streamsize>(entry.size()))) {
+        return nullptr;
+    }
+    Reader reader(entry, source, regionText);
+
+    char magic[sizeof(Magic)];
+    for (char& c : magic) {
+        c = reader.get<char>();
+    }
+    const u32 version = reader.get<u32>();
+    const bool entryContinuesSection = reader.get<u8>() != 0;
+    const std::string_view entryText = reader.getString();
+    if (reader.hasFailed() || std::memcmp(magic, Magic, sizeof(Magic)) != 0 || version != FormatVersion
+        || entryContinuesSection != continuesSection || entryText != regionText) {
+        return nullptr;
+    }
+
+    auto ast = std::make_unique<Ast::Ast>();
+    // interned in the same order the IDs in the entry come out the same
+    const u32 nameCount = reader.get<u32>();
+    for (u32 i = 0; i < nameCount && !reader.hasFailed(); ++i) {
+        if (ast->intern(reader.getString()) != i) {
+            return nullptr;
+        }
+    }
+    reader.setNameCount(nameCount);
+
+    const u32 sectionCount = reader.get<u32>();
+    for (u32 i = 0; i < sectionCount && !reader.hasFailed(); ++i) {
+        Ast::Section& section = ast->addSection(reader.getName());
+        const u64 itemCount = reader.get<u64>();
+        if (!reader.canHold(itemCount)) {
+            return nullptr;
+        }
+        section.items.reserve(itemCount);
+        for (u64 j = 0; j < itemCount; ++j) {
+            if (!getItem(reader, *ast, section, chunk.firstLine) || reader.hasFailed()) {
+                return nullptr;
+            }
+        }
+    }
+    if (reader.hasFailed() || !reader.isAtEnd()) {
+        return nullptr;
+    }
+    return ast;
+}
+
+void RegionCache::store(const SourceFile& source, const Chunk& chunk, const bool continuesSection, const Ast::Ast& ast) const {
+    const std::string_view regionText = source.getText().substr(chunk.begin, chunk.end - chunk.begin);
+    Writer writer(regionText);
+    for (const char c : Magic) {
+        writer.put<char>(c);
+    }
+    writer.put<u32>(FormatVersion);
+    writer.put<u8>(continuesSection);
+    writer.putString(regionText);
+
+    writer.put<u32>(ast.getNames().size());
+    for (Ast::NameId name = 0; name < ast.getNames().size(); ++name) {
+        writer.putString(ast.getName(name));
+    }
+    writer.put<u32>(static_cast<u32>(ast.getSections().size()));
+    for (const Ast::Section& section : ast.getSections()) {
+        writer.put<Ast::NameId>(section.name);
+        writer.put<u64>(section.items.size());
+        for (const Ast::Item& item : section.items) {
+            putItem(writer, item, chunk.firstLine);
+        }
+    }
+
+    // a region can appear twice in one file, each writer uses its own temporary file
+    const std::filesystem::path entryPath = getEntryPath(regionText, continuesSection);
+    std::filesystem::path temporaryPath = entryPath;
+    temporaryPath += std::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        out.write(writer.getData().data(), static_cast<std::streamsize>(writer.getData().size()));
+        if (!out) {
+            LOG_WARNING("Failed to write the parse cache entry '{}'", temporaryPath.string());
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, entryPath, error);
+    if (error) {
+        LOG_WARNING("Failed to write the parse cache entry '{}': {}", entryPath.string(), error.message());
+        std::filesystem::remove(temporaryPath, error);
+    }
+}
+
+} // namespace Parser
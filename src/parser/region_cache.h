@@ -0,0 +1,39 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+#include "types.h"
+#include "lexer/source_file.h"
+
+#include "ast.h"
+#include "parser.h"
+
+namespace Parser
+{
+
+// Parsed regions of source files, one file per region in a directory and named after the hash of the
+// region's text. Every entry keeps the text it was parsed from, so a hash collision is only a miss.
+// Lexemes are stored as offsets into that text and become views into the source again when loaded,
+// line numbers are relative to the start of the region so moving a region does not invalidate it.
+class RegionCache {
+    public:
+        explicit RegionCache(std::filesystem::path directory) : directory(std::move(directory)) {}
+
+        // The AST parseChunk produced for the same text, nullptr if there is none or it cannot be read
+        std::unique_ptr<Ast::Ast> load(SourceFile& source, const Chunk& chunk, bool continuesSection) const;
+
+        // Safe to call from several threads, entries are written to a temporary file and renamed
+        void store(const SourceFile& source, const Chunk& chunk, bool continuesSection, const Ast::Ast& ast) const;
+
+    private:
+        std::filesystem::path directory;
+
+        std::filesystem::path getEntryPath(std::string_view text, bool continuesSection) const;
+};
+
+} // namespace Parser
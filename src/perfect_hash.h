@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <string_view>
+#include <utility>
+
+#include "types.h"
+
+// Lookup table for a fixed set of keywords, built entirely at compile time. The seed is
+// searched until every key hashes to its own slot, so a lookup is one hash and one compare.
+template <typename Value, u64 Count>
+class PerfectHashTable {
+    public:
+        using Entry = std::pair<std::string_view, Value>;
+
+        // at most a quarter full, which keeps the seed search short
+        static constexpr u64 Size = std::bit_ceil(Count * 4);
+
+        consteval explicit PerfectHashTable(const Entry (&entries)[Count]) {
+            while (!tryFill(entries)) {
+                ++seed;
+            }
+        }
+
+        constexpr const Value* find(const std::string_view key) const {
+            const u64 slot = hash(key, seed) & (Size - 1);
+            return used[slot] && keys[slot] == key ? &values[slot] : nullptr;
+        }
+
+        constexpr bool contains(const std::string_view key) const {
+            return find(key) != nullptr;
+        }
+
+        // The table's own copy of the key, which unlike the one passed in lives for the whole program
+        constexpr std::string_view findKey(const std::string_view key) const {
+            const u64 slot = hash(key, seed) & (Size - 1);
+            return used[slot] && keys[slot] == key ? keys[slot] : std::string_view{};
+        }
+
+        // Visits every entry in slot order
+        template <typename Function>
+        constexpr void forEach(Function function) const {
+            for (u64 slot = 0; slot < Size; ++slot) {
+                if (used[slot]) {
+                    function(keys[slot], values[slot]);
+                }
+            }
+        }
+
+    private:
+        std::array<std::string_view, Size> keys{};
+        std::array<Value, Size> values{};
+        std::array<bool, Size> used{};
+        u32 seed = 0;
+
+        // FNV-1a, keywords are short enough that anything stronger is wasted
+        static constexpr u32 hash(const std::string_view key, const u32 seed) {
+            u32 value = 2166136261u ^ seed;
+            for (const char c : key) {
+                value ^= static_cast<u8>(c);
+                value *= 16777619u;
+            }
+            return value ^ (value >> 15);
+        }
+
+        consteval bool tryFill(const Entry (&entries)[Count]) {
+            used = {};
+            for (const auto& [key, value] : entries) {
+                const u64 slot = hash(key, seed) & (Size - 1);
+                if (used[slot]) {
+                    if (keys[slot] == key) {
+                        throw "duplicate key in perfect hash table";
+                    }
+                    return false;
+                }
+                used[slot] = true;
+                keys[slot] = key;
+                values[slot] = value;
+            }
+            return true;
+        }
+};
+
+template <typename Value, u64 Count>
+consteval auto makePerfectHashTable(const std::pair<std::string_view, Value> (&entries)[Count]) {
+    return PerfectHashTable<Value, Count>(entries);
+}
@@ -0,0 +1,22 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "string_pool.h"
+
+StringPool::Id StringPool::intern(const std::string_view text) {
+    if (const auto it = ids.find(text); it != ids.end()) {
+        return it->second;
+    }
+    const std::string_view stored(storage.copy(std::span(text)).data(), text.size());
+    const Id id = static_cast<Id>(strings.size());
+    strings.push_back(stored);
+    ids.emplace(stored, id);
+    return id;
+}
+
+std::optional<StringPool::Id> StringPool::find(const std::string_view text) const {
+    if (const auto it = ids.find(text); it != ids.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.h"
+#include "types.h"
+
+// Keeps one copy of every name and hands out dense 32 bit IDs for them. The characters live in
+// the pool's own arena, so IDs and views stay valid for as long as the pool does.
+class StringPool {
+    public:
+        using Id = u32;
+
+        StringPool() = default;
+
+        StringPool(const StringPool&) = delete;
+        StringPool& operator=(const StringPool&) = delete;
+
+        Id intern(std::string_view text);
+        std::optional<Id> find(std::string_view text) const;
+
+        std::string_view get(const Id id) const {
+            return strings[id];
+        }
+
+        u32 size() const {
+            return static_cast<u32>(strings.size());
+        }
+
+        void reserve(const u32 count) {
+            strings.reserve(count);
+            ids.reserve(count);
+        }
+
+    private:
+        Arena storage;
+        std::vector<std::string_view> strings;
+        std::unordered_map<std::string_view, Id> ids;
+};
@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "types.h"
+
+// Fixed set of worker threads for work that is split up front, like the chunks of a large source file.
+// Jobs start in submission order, the returned futures deliver their results.
+class ThreadPool {
+    public:
+        // 0 starts one thread per core
+        explicit ThreadPool(u32 threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        template <typename Function>
+        std::future<std::invoke_result_t<Function>> submit(Function function) {
+            using Result = std::invoke_result_t<Function>;
+            // std::function needs a copyable target, the task itself is move only
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+            std::future<Result> result = task->get_future();
+            {
+                std::scoped_lock lock(mutex);
+                jobs.emplace([task] {
+                    (*task)();
+                });
+            }
+            condition.notify_one();
+            return result;
+        }
+
+        u32 getThreadCount() const {
+            return static_cast<u32>(threads.size());
+        }
+
+    private:
+        std::vector<std::thread> threads;
+        std::queue<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping = false;
+
+        void work();
+};
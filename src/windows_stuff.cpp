@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include <Windows.h>
+#include <io.h>
 
 #include "windows_stuff.h"
 
@@ -16,3 +17,33 @@ void Win_SetConsoleCP(u32 codePageID) {
 void Win_SetConsoleOutputCP(u32 codePageID) {
     SetConsoleOutputCP(codePageID);
 }
+
+u8* Win_MapFile(s32 fd, u64 offset, u64 length, bool shared, bool writable, void*& view) {
+    HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+
+    DWORD protection = shared ? (writable ? PAGE_READWRITE : PAGE_READONLY) : PAGE_WRITECOPY;
+    HANDLE mapping = CreateFileMappingW(file, nullptr, protection, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        return nullptr;
+    }
+
+    // views have to start at the allocation granularity, which is larger than a page
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    u64 alignedOffset = offset - offset % systemInfo.dwAllocationGranularity;
+    DWORD access = shared ? (writable ? FILE_MAP_WRITE : FILE_MAP_READ) : FILE_MAP_COPY;
+    view = MapViewOfFile(mapping, access, static_cast<DWORD>(alignedOffset >> 32), static_cast<DWORD>(alignedOffset),
+                         static_cast<SIZE_T>(length + offset - alignedOffset));
+    CloseHandle(mapping); // the view keeps the mapping alive
+    if (view == nullptr) {
+        return nullptr;
+    }
+    return static_cast<u8*>(view) + (offset - alignedOffset);
+}
+
+void Win_UnmapFile(void* view) {
+    UnmapViewOfFile(view);
+}
@@ -7,4 +7,6 @@
 
 u32 Win_GetConsoleCP();
 void Win_SetConsoleCP(u32 codePageID);
-void Win_SetConsoleOutputCP(u32 codePageID);
\ No newline at end of file
+void Win_SetConsoleOutputCP(u32 codePageID);
+u8* Win_MapFile(s32 fd, u64 offset, u64 length, bool shared, bool writable, void*& view);
+void Win_UnmapFile(void* view);
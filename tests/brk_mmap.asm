@@ -0,0 +1,50 @@
+.section .text
+
+.global _start
+_start:
+    # brk(0) returns the initial program break
+    mov $12, %rax
+    mov $0, %rdi
+    syscall
+    mov %rax, %rbx
+
+    # grow the heap by one page
+    lea 4096(%rbx), %rdi
+    mov $12, %rax
+    syscall
+    sub %rbx, %rax
+    checkpoint $1
+
+    movq $42, (%rbx)
+    mov (%rbx), %rcx
+    checkpoint $2
+
+    # mmap(NULL, 8192, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+    mov $9, %rax
+    mov $0, %rdi
+    mov $8192, %rsi
+    mov $3, %rdx
+    mov $0x22, %r10
+    mov $-1, %r8
+    mov $0, %r9
+    syscall
+    mov %rax, %r12
+    movq $7, 4096(%r12)
+    mov 4096(%r12), %rcx
+    checkpoint $3
+
+    # mprotect(addr, 4096, PROT_READ)
+    mov $10, %rax
+    mov %r12, %rdi
+    mov $4096, %rsi
+    mov $1, %rdx
+    syscall
+    mov (%r12), %rcx
+    checkpoint $4
+
+    # munmap(addr, 8192)
+    mov $11, %rax
+    mov %r12, %rdi
+    mov $8192, %rsi
+    syscall
+    checkpoint $5
@@ -0,0 +1,44 @@
+.section .rodata
+path:
+    .asciz "closed_fd_write.tmp"
+message:
+    .ascii "data"
+
+.section .text
+
+.global _start
+_start:
+    # open("closed_fd_write.tmp", O_CREAT | O_WRONLY | O_TRUNC, 0644)
+    mov $2, %rax
+    lea path(%rip), %rdi
+    mov $0x241, %rsi
+    mov $0644, %rdx
+    syscall
+    mov %rax, %rbx
+
+    mov $1, %rax
+    mov %rbx, %rdi
+    lea message(%rip), %rsi
+    mov $4, %rdx
+    syscall
+    mov %rax, %rcx
+
+    mov $3, %rax
+    mov %rbx, %rdi
+    syscall
+
+    # writes to the closed descriptor fail with EBADF, buffered or not
+    mov $1, %rax
+    mov %rbx, %rdi
+    lea message(%rip), %rsi
+    mov $4, %rdx
+    syscall
+    mov %rax, %r12
+
+    # and so do writes to one that was never open
+    mov $1, %rax
+    mov $99, %rdi
+    lea message(%rip), %rsi
+    mov $4, %rdx
+    syscall
+    checkpoint $1
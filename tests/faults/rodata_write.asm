@@ -0,0 +1,15 @@
+# .rodata is mapped read-only, the write after the checkpoint has to fault, see run_tests.sh
+.section .rodata
+value:
+    .quad 7
+
+.section .text
+
+.global _start
+_start:
+    lea value(%rip), %rdx
+    mov (%rdx), %rax
+    checkpoint $1
+
+    movq $1, (%rdx)
+    checkpoint $2
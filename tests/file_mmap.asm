@@ -0,0 +1,63 @@
+.section .rodata
+path:
+    .asciz "file_mmap.tmp"
+contents:
+    .ascii "ABCDEFGH"
+
+.section .bss
+buffer:
+    .zero 8
+
+.section .text
+
+.global _start
+_start:
+    # open("file_mmap.tmp", O_CREAT | O_RDWR | O_TRUNC, 0644) and write the contents the mapping reads back
+    mov $2, %rax
+    lea path(%rip), %rdi
+    mov $0x242, %rsi
+    mov $0644, %rdx
+    syscall
+    mov %rax, %rbx
+
+    mov $1, %rax
+    mov %rbx, %rdi
+    lea contents(%rip), %rsi
+    mov $8, %rdx
+    syscall
+
+    # mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) sees the write from before
+    mov $9, %rax
+    mov $0, %rdi
+    mov $4096, %rsi
+    mov $3, %rdx
+    mov $1, %r10
+    mov %rbx, %r8
+    mov $0, %r9
+    syscall
+    mov %rax, %r12
+    xor %rcx, %rcx
+    movb 3(%r12), %cl
+    checkpoint $1
+
+    # a store into the shared mapping reaches the file
+    movb $0x7a, (%r12)
+    mov $11, %rax
+    mov %r12, %rdi
+    mov $4096, %rsi
+    syscall
+
+    mov $8, %rax
+    mov %rbx, %rdi
+    mov $0, %rsi
+    mov $0, %rdx
+    syscall
+
+    mov $0, %rax
+    mov %rbx, %rdi
+    lea buffer(%rip), %rsi
+    mov $8, %rdx
+    syscall
+    lea buffer(%rip), %rsi
+    mov (%rsi), %rdx
+    checkpoint $2
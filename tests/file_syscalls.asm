@@ -0,0 +1,75 @@
+.section .data
+first:
+    .ascii "ab"
+second:
+    .ascii "cd\n"
+iov:
+    .quad first, 2, second, 3
+
+.section .bss
+buffer:
+    .zero 256
+
+.section .text
+
+.global _start
+_start:
+    # writev(1, iov, 2) writes both buffers at once
+    mov $20, %rax
+    mov $1, %rdi
+    lea iov(%rip), %rsi
+    mov $2, %rdx
+    syscall
+    checkpoint $1
+
+    # getrandom(buffer, 16, 0)
+    mov $318, %rax
+    lea buffer(%rip), %rdi
+    mov $16, %rsi
+    mov $0, %rdx
+    syscall
+    checkpoint $2
+
+    # clock_gettime(CLOCK_MONOTONIC, buffer)
+    mov $228, %rax
+    mov $1, %rdi
+    lea buffer(%rip), %rsi
+    syscall
+    checkpoint $3
+
+    # fstat(1, buffer)
+    mov $5, %rax
+    mov $1, %rdi
+    lea buffer(%rip), %rsi
+    syscall
+    checkpoint $4
+
+    # read into an unmapped buffer fails with EFAULT, the page below the lowest stack address is never a section
+    mov $0, %rax
+    mov $0, %rdi
+    mov $0xfffffffffefff000, %rsi
+    mov $4, %rdx
+    syscall
+    checkpoint $5
+
+    # close of a descriptor that is not open fails with EBADF
+    mov $3, %rax
+    mov $1000, %rdi
+    syscall
+    checkpoint $6
+
+    # write and pwrite64 of an unmapped buffer with the largest count fail with EFAULT
+    mov $1, %rax
+    mov $1, %rdi
+    mov $0xfffffffffefff000, %rsi
+    mov $0x7ffff000, %rdx
+    syscall
+    checkpoint $7
+
+    mov $18, %rax
+    mov $1, %rdi
+    mov $0xfffffffffefff000, %rsi
+    mov $0x7ffff000, %rdx
+    mov $0, %r10
+    syscall
+    checkpoint $8
@@ -0,0 +1,25 @@
+.section .data
+# both symbols are defined further down, the linker patches the quads once it placed them
+table:
+    .quad later, value
+
+.section .rodata
+value:
+    .quad 7
+
+.section .text
+
+.global _start
+_start:
+    lea table(%rip), %rsi
+    mov (%rsi), %rax
+    lea later(%rip), %rcx
+    sub %rcx, %rax
+
+    # the second quad points at value in .rodata
+    mov 8(%rsi), %rbx
+    mov (%rbx), %r8
+    lea value(%rip), %rdx
+    sub %rdx, %rbx
+later:
+    checkpoint $1
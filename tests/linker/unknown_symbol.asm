@@ -0,0 +1,7 @@
+# missing is never defined, linking has to fail, see run_tests.sh
+.section .text
+
+.global _start
+_start:
+    mov $1, %rax
+    jmp missing
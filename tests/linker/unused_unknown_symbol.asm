@@ -0,0 +1,12 @@
+# unused is never called and refers to a label that does not exist. --lazyLink never lowers it,
+# so the program runs, an eager link fails. See run_tests.sh.
+.section .text
+
+.global _start
+_start:
+    mov $60, %rax
+    mov $0, %rdi
+    syscall
+
+unused:
+    jmp missing
@@ -0,0 +1,6 @@
+# _start without .globl is local to this file, a program of several files has no entry point then
+.section .text
+
+_start:
+    mov $5, %rdi
+    jmp finish
@@ -0,0 +1,19 @@
+# Linked together with runtime.asm, see run_tests.sh. Both files define helper, .L2 and value without .globl,
+# every file has to reach its own.
+.section .data
+value:
+    .quad 7
+
+.section .text
+
+.globl _start
+_start:
+    mov $5, %rdi
+    call helper
+    jmp finish
+
+helper:
+    add $100, %rdi
+    jmp .L2
+.L2:
+    ret
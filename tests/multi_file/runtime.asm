@@ -0,0 +1,19 @@
+.section .data
+value:
+    .quad 10
+
+.section .text
+
+.globl finish
+finish:
+    call helper
+    lea value(%rip), %rsi
+    mov (%rsi), %rax
+    add %rax, %rdi
+    checkpoint $1
+
+helper:
+    add $1, %rdi
+    jmp .L2
+.L2:
+    ret
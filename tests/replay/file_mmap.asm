@@ -0,0 +1,35 @@
+# Maps a file the program wrote itself, recording works but the mapping cannot be replayed, see run_tests.sh
+.section .rodata
+path:
+    .asciz "replay_mmap.bin"
+contents:
+    .ascii "ABCDEFGH"
+
+.section .text
+.global _start
+_start:
+    # open("replay_mmap.bin", O_CREAT | O_RDWR | O_TRUNC, 0644)
+    mov $2, %rax
+    lea path(%rip), %rdi
+    mov $0x242, %rsi
+    mov $0644, %rdx
+    syscall
+    mov %rax, %rbx
+
+    mov $1, %rax
+    mov %rbx, %rdi
+    lea contents(%rip), %rsi
+    mov $8, %rdx
+    syscall
+
+    # mmap(NULL, 4096, PROT_READ, MAP_PRIVATE, fd, 0)
+    mov $9, %rax
+    mov $0, %rdi
+    mov $4096, %rsi
+    mov $1, %rdx
+    mov $2, %r10
+    mov %rbx, %r8
+    mov $0, %r9
+    syscall
+    mov (%rax), %rcx
+    checkpoint $1
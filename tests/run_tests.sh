@@ -0,0 +1,145 @@
+#!/usr/bin/env bash
+# SPDX-FileCopyrightText: Copyright 2026 AsmCube Project
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+# Runs every checkpoint test in this directory, then the cases that need command line options.
+# Usage: tests/run_tests.sh <path to AsmCube>
+
+asmcube=$(realpath "${1:?usage: $0 <path to AsmCube>}")
+tests=$(dirname "$(realpath "$0")")
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cd "$work" || exit 1
+failed=0
+
+# expectPass <name> <arguments...>, the run has to exit with 0 and log no error
+expectPass() {
+    local name=$1
+    shift
+    local output
+    if output=$("$asmcube" "$@" 2>&1) && ! grep -q "ERROR" <<< "$output"; then
+        echo "PASS $name"
+    else
+        echo "FAIL $name"
+        tail -n 5 <<< "$output"
+        failed=1
+    fi
+}
+
+# expectError <name> <message> <arguments...>, the run has to fail with an error containing message
+expectError() {
+    local name=$1
+    local message=$2
+    shift 2
+    local output
+    if ! output=$("$asmcube" "$@" 2>&1) && grep -q -- "$message" <<< "$output"; then
+        echo "PASS $name"
+    else
+        echo "FAIL $name"
+        tail -n 5 <<< "$output"
+        failed=1
+    fi
+}
+
+# expectOutput <name> <text> <arguments...>, the run has to exit with 0 and print text
+expectOutput() {
+    local name=$1
+    local text=$2
+    shift 2
+    local output
+    if output=$("$asmcube" "$@" 2>&1) && grep -q -- "$text" <<< "$output"; then
+        echo "PASS $name"
+    else
+        echo "FAIL $name"
+        tail -n 5 <<< "$output"
+        failed=1
+    fi
+}
+
+for test in "$tests"/*.asm; do
+    expectPass "$(basename "$test")" "$test" --testMode
+done
+
+# and with functions lowered the first time they run
+for test in "$tests"/*.asm; do
+    expectPass "$(basename "$test") (lazyLink)" "$test" --testMode --lazyLink
+done
+
+# every checkpoint test again from a program image, the image is run next to a copy of its checkpoints
+for test in "$tests"/*.asm; do
+    name=$(basename "$test" .asm)
+    "$asmcube" "$test" --emitImage "$name.acimg" > /dev/null 2>&1
+    cp "$tests/$name.yaml" "$name.yaml"
+    expectPass "$name (program image)" "$name.acimg" --testMode
+done
+
+# images with counts that do not fit the file are rejected instead of read past their end
+cp "$(ls ./*.acimg | head -n 1)" corrupt.acimg
+printf '\xff\xff\xff\x7f' | dd of=corrupt.acimg bs=1 seek=24 conv=notrunc status=none
+expectError "corrupt program image" "truncated" corrupt.acimg
+
+# file syscalls against a virtual filesystem loaded from a tar archive
+tar -cf vfs.tar -C "$tests/vfs/root" .
+expectPass "vfs_files.asm" "$tests/vfs/vfs_files.asm" --testMode --vfs vfs.tar
+
+# a recorded run replays without the host, file backed mappings are rejected because the recording has no file contents
+expectPass "file_syscalls.asm (record)" "$tests/file_syscalls.asm" --testMode --record file_syscalls.rec
+expectPass "file_syscalls.asm (replay)" "$tests/file_syscalls.asm" --testMode --replay file_syscalls.rec
+expectPass "file_mmap.asm (record)" "$tests/replay/file_mmap.asm" --testMode --record file_mmap.rec
+expectError "file_mmap.asm (replay)" "cannot be replayed" "$tests/replay/file_mmap.asm" --testMode --replay file_mmap.rec
+
+# asynchronous writes bypass the output buffer, they are counted in its statistics when they complete
+expectPass "file_syscalls.asm (asyncIo)" "$tests/file_syscalls.asm" --testMode --asyncIo
+expectOutput "write_stdout.asm (asyncIo)" "fd 1: 1 writes, 1 host writes, 13 bytes" "$tests/write_stdout.asm" --testMode --asyncIo
+
+# the write-combining buffer checks a descriptor once and drops its buffer on close
+expectPass "closed_fd_write.asm (bufferOutput)" "$tests/closed_fd_write.asm" --testMode --bufferOutput
+expectOutput "write_stdout.asm (bufferOutput)" "fd 1: 1 writes, 1 host writes, 13 bytes" "$tests/write_stdout.asm" --testMode --bufferOutput
+
+# writes into read-only sections fault instead of changing the constant
+expectError "rodata_write.asm" "Write access violation" "$tests/faults/rodata_write.asm" --testMode
+
+# several files link into one program, labels without .globl stay in their file
+expectPass "multi_file" "$tests/multi_file/main.asm" "$tests/multi_file/runtime.asm" --testMode
+expectError "multi_file (local reference)" "Unknown symbol 'helper'" "$tests/multi_file/local_reference.asm" "$tests/multi_file/runtime.asm"
+expectPass "multi_file (cold cache)" "$tests/multi_file/main.asm" "$tests/multi_file/runtime.asm" --testMode --cacheDir multi_file_cache
+expectOutput "multi_file (warm cache)" "2 of 2 files read from the parse cache" "$tests/multi_file/main.asm" "$tests/multi_file/runtime.asm" --testMode --cacheDir multi_file_cache --logLevel debug
+expectError "multi_file (local _start)" ".globl _start" "$tests/multi_file/local_start.asm" "$tests/multi_file/runtime.asm"
+
+# a second run over unchanged text reads every region from the parse cache, the file is large enough for several regions
+{
+    printf '.section .text\n.global _start\n_start:\n'
+    for ((i = 0; i < 20000; ++i)); do
+        printf '    add $1, %%rax\n'
+    done
+    printf '    mov $60, %%rax\n    mov $0, %%rdi\n    syscall\n'
+} > cached.asm
+expectPass "cached.asm (cold cache)" cached.asm --cacheDir parse_cache
+expectOutput "cached.asm (warm cache)" "regions read from the parse cache, 0 parsed" cached.asm --cacheDir parse_cache --logLevel debug
+
+# references to labels that are defined nowhere fail the link
+expectError "unknown_symbol.asm" "Unknown symbol 'missing'" "$tests/linker/unknown_symbol.asm"
+
+# --lazyLink only reports errors in functions that run
+expectPass "unused_unknown_symbol.asm (lazyLink)" "$tests/linker/unused_unknown_symbol.asm" --lazyLink
+expectError "unused_unknown_symbol.asm" "Unknown symbol 'missing'" "$tests/linker/unused_unknown_symbol.asm"
+
+# sections cannot be placed on the null page
+expectError "sectionBases text=0" "Invalid section bases" "$tests/add.asm" --sectionBases text=0
+
+# more relocations than one batch holds are applied by several threads, the blocks are laid out
+# backwards so every jump has to be patched with the right target
+relocationCount=70000
+{
+    printf '.section .text\n.global _start\n_start:\n    mov $0, %%rax\n    jmp L0\nL%d:\n    checkpoint $1\n' $relocationCount
+    for ((i = relocationCount - 1; i >= 0; --i)); do
+        printf 'L%d:\n    add $1, %%rax\n    jmp L%d\n' $i $((i + 1))
+    done
+} > relocations.asm
+printf -- '- id: 1\n  registers: { rax: %d }\n  flags: {}\n  exit: true\n' $relocationCount > relocations.yaml
+expectPass "relocations.asm (threaded batches)" relocations.asm --testMode --frontendThreads 4
+expectPass "relocations.asm (one thread)" relocations.asm --testMode --frontendThreads 1
+sed 's/jmp L0$/jmp missing/' relocations.asm > relocations_unknown.asm
+expectError "relocations_unknown.asm (threaded batches)" "Unknown symbol 'missing'" relocations_unknown.asm --frontendThreads 4
+
+exit $failed
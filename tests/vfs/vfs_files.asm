@@ -0,0 +1,94 @@
+# Runs with the files in root/ packed into a tar archive and loaded with --vfs, see run_tests.sh
+.section .rodata
+path:
+    .asciz "/sub/data.txt"
+newpath:
+    .asciz "sub/new.txt"
+
+.section .bss
+buffer:
+    .zero 64
+
+.section .text
+.global _start
+_start:
+    # open and read a file from the archive
+    mov $2, %rax
+    lea path(%rip), %rdi
+    mov $0, %rsi
+    mov $0, %rdx
+    syscall
+    mov %rax, %rbx
+
+    mov $0, %rax
+    mov %rbx, %rdi
+    lea buffer(%rip), %rsi
+    mov $64, %rdx
+    syscall
+    mov %rax, %rcx
+    lea buffer(%rip), %rsi
+    mov (%rsi), %rdx
+    checkpoint $1
+
+    # create a file, write to it and read it back from an offset
+    mov $2, %rax
+    lea newpath(%rip), %rdi
+    mov $0x42, %rsi
+    mov $0644, %rdx
+    syscall
+    mov %rax, %r12
+
+    mov $1, %rax
+    mov %r12, %rdi
+    lea buffer(%rip), %rsi
+    mov $9, %rdx
+    syscall
+
+    mov $8, %rax
+    mov %r12, %rdi
+    mov $4, %rsi
+    mov $0, %rdx
+    syscall
+
+    mov $0, %rax
+    mov %r12, %rdi
+    lea buffer(%rip), %rsi
+    add $32, %rsi
+    mov $64, %rdx
+    syscall
+    mov %rax, %rcx
+    lea buffer(%rip), %rsi
+    mov 32(%rsi), %rdx
+    checkpoint $2
+
+    # reading at the end of the file returns 0
+    mov $0, %rax
+    mov %r12, %rdi
+    lea buffer(%rip), %rsi
+    mov $64, %rdx
+    syscall
+    mov %rax, %rcx
+
+    # a write far past the end would grow the file beyond its limit, EFBIG
+    mov $8, %rax
+    mov %r12, %rdi
+    mov $0x4000000000000000, %rsi
+    mov $0, %rdx
+    syscall
+    mov %rax, %r13
+
+    mov $1, %rax
+    mov %r12, %rdi
+    lea buffer(%rip), %rsi
+    mov $9, %rdx
+    syscall
+    mov %rax, %r14
+
+    # and so does a seek that overflows the position, EINVAL
+    mov $8, %rax
+    mov %r12, %rdi
+    mov $0x4000000000000000, %rsi
+    mov $1, %rdx
+    syscall
+    mov %rax, %r15
+    checkpoint $3
@@ -0,0 +1,15 @@
+.section .rodata
+message:
+    .ascii "write_stdout\n"
+
+.section .text
+
+.global _start
+_start:
+    # write(1, message, 13) returns the bytes written
+    mov $1, %rax
+    mov $1, %rdi
+    lea message(%rip), %rsi
+    mov $13, %rdx
+    syscall
+    checkpoint $1